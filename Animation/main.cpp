@@ -7,10 +7,91 @@
  * speed and shape can be changed by keystroke.
  */
 #include "headers.h"
+#include "../Shared/framebuffer.h"
+#ifdef USE_OSMESA
+#include <GL/osmesa.h>
+#endif
 
 static int slices = 16;
 static int stacks = 16;
 
+/**
+ * Headless mode (-headless out.ppm [-time t]): no window is opened. One
+ * frame, as it looks t seconds after the start, is rendered offscreen by
+ * OSMesa into the software framebuffer "screen" and written to out.ppm.
+ * It needs a build with -DUSE_OSMESA linked against libOSMesa.
+ */
+const char *headless_output = NULL;
+double headless_time = 0;
+framebuffer screen;
+GLUquadric *quadric = NULL;
+
+/**
+ * Sphere, Cone, Torus - the glutSolid and glutWire shapes. GLUT can only
+ * draw them after glutInit, so in headless mode the same shapes are built
+ * from GLU quadrics and a torus of quad strips.
+ */
+static void Sphere(GLdouble radius, GLint slices, GLint stacks, bool solid)
+{
+    if(headless_output == NULL)
+    {
+        if(solid) glutSolidSphere(radius,slices,stacks);
+        else glutWireSphere(radius,slices,stacks);
+        return;
+    }
+
+    gluQuadricDrawStyle(quadric, solid ? GLU_FILL : GLU_LINE);
+    gluSphere(quadric, radius, slices, stacks);
+}
+
+static void Cone(GLdouble base, GLdouble height, GLint slices, GLint stacks, bool solid)
+{
+    if(headless_output == NULL)
+    {
+        if(solid) glutSolidCone(base,height,slices,stacks);
+        else glutWireCone(base,height,slices,stacks);
+        return;
+    }
+
+    gluQuadricDrawStyle(quadric, solid ? GLU_FILL : GLU_LINE);
+    gluCylinder(quadric, base, 0, height, slices, stacks);
+
+    /// the bottom disk faces -z
+    glPushMatrix();
+    glRotated(180,1,0,0);
+    gluDisk(quadric, 0, base, slices, 1);
+    glPopMatrix();
+}
+
+static void Torus(GLdouble innerRadius, GLdouble outerRadius, GLint nsides, GLint rings, bool solid)
+{
+    if(headless_output == NULL)
+    {
+        if(solid) glutSolidTorus(innerRadius,outerRadius,nsides,rings);
+        else glutWireTorus(innerRadius,outerRadius,nsides,rings);
+        return;
+    }
+
+    if(!solid) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+
+    for (int i = 0; i<rings; i++)
+    {
+        glBegin(GL_QUAD_STRIP);
+        for (int j = 0; j<=nsides; j++)
+            for (int k = 0; k<2; k++)
+            {
+                double phi = 2*PI*(i+k)/rings, theta = 2*PI*j/nsides;
+                double r = outerRadius + innerRadius*cos(theta);
+
+                glNormal3d(cos(phi)*cos(theta), sin(phi)*cos(theta), sin(theta));
+                glVertex3d(cos(phi)*r, sin(phi)*r, innerRadius*sin(theta));
+            }
+        glEnd();
+    }
+
+    if(!solid) glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+}
+
 /* GLUT callback Handlers */
 
 static void resize(int width, int height)
@@ -72,7 +153,7 @@ static void display(void)
      *                        GLUT_ELAPSED_TIME - Number of milliseconds since glutInit
      *                        called (or first call to glutGet(GLUT_ELAPSED_TIME))
      */
-    const double t = glutGet(GLUT_ELAPSED_TIME) / 1000.0;
+    const double t = headless_output != NULL ? headless_time : glutGet(GLUT_ELAPSED_TIME) / 1000.0;
     const double a = t*90.0;
 
 
@@ -95,7 +176,7 @@ static void display(void)
     glTranslated(-2.4,1.2,-6);
     glRotated(60,1,0,0);
     glRotated(a,0,0,1);
-    glutSolidSphere(1,slices,stacks);
+    Sphere(1,slices,stacks,true);
 
     /**
      * void glPopMatrix(void); - pop the current matrix stack
@@ -121,7 +202,7 @@ static void display(void)
      * void glutSolidCone(GLdouble base,GLdouble height,GLint slices,GLint stacks) -
      *                                                          render a solid cone
      */
-    glutSolidCone(1,1,slices,stacks);
+    Cone(1,1,slices,stacks,true);
     glPopMatrix();
 
     glPushMatrix();
@@ -133,7 +214,7 @@ static void display(void)
      * void glutSolidTorus(GLdouble innerRadius,GLdouble outerRadius,GLint nsides,GLint rings) -
      *                                                          render a solid torus (doughnut)
      */
-    glutSolidTorus(0.2,0.8,slices,stacks);
+    Torus(0.2,0.8,slices,stacks,true);
     glPopMatrix();
 
     glPushMatrix();
@@ -145,7 +226,7 @@ static void display(void)
      * void glutWireSphere(GLdouble radius,GLint slices,GLint stacks) - render a
      *                                                          wireframe sphere
      */
-    glutWireSphere(1,slices,stacks);
+    Sphere(1,slices,stacks,false);
     glPopMatrix();
 
     glPushMatrix();
@@ -157,7 +238,7 @@ static void display(void)
      * void glutWireCone(GLdouble base,GLdouble height,GLint slices,GLint stacks) -
      *                                                        render wireframe cone
      */
-    glutWireCone(1,1,slices,stacks);
+    Cone(1,1,slices,stacks,false);
     glPopMatrix();
 
     glPushMatrix();
@@ -169,10 +250,10 @@ static void display(void)
      * void glutWireTorus(GLdouble innerRadius,GLdouble outerRadius,GLint nsides,GLint rings) -
      *                                                      render a wireframe torus (doughnut)
      */
-    glutWireTorus(0.2,0.8,slices,stacks);
+    Torus(0.2,0.8,slices,stacks,false);
     glPopMatrix();
 
-    glutSwapBuffers();
+    if(headless_output == NULL) glutSwapBuffers();
 }
 
 
@@ -225,71 +306,103 @@ const GLfloat high_shininess[] = { 100.0f };
 
 int main(int argc, char *argv[])
 {
-    /**
-     * glutInit(int, char*) - initializes glut environment.
-     */
-    glutInit(&argc, argv);
-
-    /**
-     * glutInitWindowSize(int,int)- initializes new glut window of
-     *                              size W * H
-     *                              default: 300, 300
-     */
-    glutInitWindowSize(640,480);
-
-    /**
-     * glutInitWindowPosition(int,int) - set the origin of the
-     *                                   co-ordinate
-     *                                   default: -1, -1
-     */
-    glutInitWindowPosition(10,10);
-
-    /**
-     * glutInitDisplayMode(unsigned int) - set the initial display mode.
-     *                      It can take a combinations of some masks
-     *                      which are not overlapped in their binary
-     *                      representation. So, it takes them having
-     *                      bitwise OR.
-     * GLUT_RGB - the color input would by set by RGB values.
-     * GLUT_DOUBLE - makes it double buffered. It is like using two blackboard.
-     *               One blackboard would be shown to the screen and hidden one
-     *               would be processed behind. they can be swapped any time.
-     * GLUT_DEPTH - It is mainly enables depth concept. Algorithm like z-buffering
-     *              could be done by using this.
-     */
-    glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
-
-    /**
-     * glutCreateWindow(char*) - creates a top-level window having the title
-     *                           given as parameter.
-     */
-    glutCreateWindow("GLUT Shapes");
-
-    /**
-     * void glutReshapeFunc(void (*func)(int width, int height)) - sets the reshape
-     *                                              callback for the current window
-     */
-    glutReshapeFunc(resize);
-
-    /**
-     * void glutDisplayFunc(void (*func)(void))  - this function takes a function pointer
-     *                                             in which all works done.
-     */
-    glutDisplayFunc(display);
-
-    /**
-     * void glutKeyboardFunc(void (*func)(unsigned char key, int x, int y)) -
-     *             this function takes a function pointer which works as keyboard listener
-     */
-    glutKeyboardFunc(key);
-
+    for (int i = 1; i<argc; i++)
+    {
+        if(strcmp(argv[i], "-headless") == 0 && i+1<argc) headless_output = argv[++i];
+        else if(strcmp(argv[i], "-time") == 0 && i+1<argc) headless_time = atof(argv[++i]);
+    }
 
-    /**
-     * void glutIdleFunc(void (*func)(void)) - this function takes a function pointer which
-     *                                         does work when window system events are not
-     *                                         being received.
-     */
-    glutIdleFunc(idle);
+    if(headless_output == NULL)
+    {
+        /**
+         * glutInit(int, char*) - initializes glut environment.
+         */
+        glutInit(&argc, argv);
+
+        /**
+         * glutInitWindowSize(int,int)- initializes new glut window of
+         *                              size W * H
+         *                              default: 300, 300
+         */
+        glutInitWindowSize(640,480);
+
+        /**
+         * glutInitWindowPosition(int,int) - set the origin of the
+         *                                   co-ordinate
+         *                                   default: -1, -1
+         */
+        glutInitWindowPosition(10,10);
+
+        /**
+         * glutInitDisplayMode(unsigned int) - set the initial display mode.
+         *                      It can take a combinations of some masks
+         *                      which are not overlapped in their binary
+         *                      representation. So, it takes them having
+         *                      bitwise OR.
+         * GLUT_RGB - the color input would by set by RGB values.
+         * GLUT_DOUBLE - makes it double buffered. It is like using two blackboard.
+         *               One blackboard would be shown to the screen and hidden one
+         *               would be processed behind. they can be swapped any time.
+         * GLUT_DEPTH - It is mainly enables depth concept. Algorithm like z-buffering
+         *              could be done by using this.
+         */
+        glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
+
+        /**
+         * glutCreateWindow(char*) - creates a top-level window having the title
+         *                           given as parameter.
+         */
+        glutCreateWindow("GLUT Shapes");
+
+        /**
+         * void glutReshapeFunc(void (*func)(int width, int height)) - sets the reshape
+         *                                              callback for the current window
+         */
+        glutReshapeFunc(resize);
+
+        /**
+         * void glutDisplayFunc(void (*func)(void))  - this function takes a function pointer
+         *                                             in which all works done.
+         */
+        glutDisplayFunc(display);
+
+        /**
+         * void glutKeyboardFunc(void (*func)(unsigned char key, int x, int y)) -
+         *             this function takes a function pointer which works as keyboard listener
+         */
+        glutKeyboardFunc(key);
+
+
+        /**
+         * void glutIdleFunc(void (*func)(void)) - this function takes a function pointer which
+         *                                         does work when window system events are not
+         *                                         being received.
+         */
+        glutIdleFunc(idle);
+    }
+    else
+    {
+#ifdef USE_OSMESA
+        /**
+         * OSMesaCreateContextExt(GLenum format, GLint depthBits, GLint stencilBits,
+         *                        GLint accumBits, OSMesaContext sharelist) -
+         *                        creates an offscreen rendering context.
+         * OSMesaMakeCurrent(...) - binds it to an image buffer in memory; here
+         *                          the pixels of the software framebuffer.
+         */
+        fb_init(screen, 0, 0, 640, 480);
+        OSMesaContext context = OSMesaCreateContextExt(OSMESA_RGBA, 16, 0, 0, NULL);
+        if(context == NULL || !OSMesaMakeCurrent(context, &screen.pixels[0], GL_UNSIGNED_BYTE, 640, 480))
+        {
+            printf("Could not create an OSMesa context\n");
+            return EXIT_FAILURE;
+        }
+        quadric = gluNewQuadric();
+#else
+        printf("Headless mode needs OSMesa: build with -DUSE_OSMESA and link with -lOSMesa\n");
+        return EXIT_FAILURE;
+#endif
+    }
 
 
     /**
@@ -414,6 +527,26 @@ int main(int argc, char *argv[])
     glMaterialfv(GL_FRONT, GL_SHININESS, high_shininess);
 
 
+    if(headless_output != NULL)
+    {
+        double start = fb_clock_ms();
+        resize(640,480);
+        display();
+
+        /**
+         * void glFinish(void) - blocks until all GL execution is complete,
+         *                       so the framebuffer holds the whole frame.
+         */
+        glFinish();
+        printf("Frame time: %.3f ms\n", fb_clock_ms() - start);
+        if(!fb_write_ppm(screen, headless_output))
+        {
+            printf("Could not write %s\n", headless_output);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
     /**
      * glutMainLoop() - enters the GLUT event processing loop. This routine should be
      *                  called at most once in a GLUT program. Once called, this routine
@@ -0,0 +1,239 @@
+#ifndef ANTIALIAS_H_INCLUDED
+#define ANTIALIAS_H_INCLUDED
+
+/**
+ * Anti-aliased lines (Xiaolin Wu)
+ *
+ * Every pixel along the major axis is split between the two pixels
+ * around the ideal line, in proportion to the distance. The minor
+ * co-ordinate is walked exactly, in 1/256 pixels plus an error term as
+ * in Bresenham's loop, so even a segment of billions of pixels stays on
+ * the ideal line. The coverage of the farther pixel is the fraction f
+ * in 1/256 and of the nearer one 256 - f, so the blend
+ *
+ *      out = (dst*(256-a) + color*a) >> 8      (per 8 bit channel)
+ *
+ * is pure integer math. With AVX2 eight consecutive pixels of the major
+ * axis are blended at once: the sixteen destination pixels gathered,
+ * blended in 16 bit lanes and stored back. The eight pixels of a batch
+ * are all in different columns (rows for steep segments), so they never
+ * overlap. The scalar path does the same arithmetic, so both give the
+ * same picture.
+ *
+ * Like the aliased kernels, a segment is first cut to the pixels whose
+ * pair can reach the viewport, with the exact closed forms of line.h,
+ * so huge segments cost only what is seen.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "../Shared/framebuffer.h"
+#include "line.h"
+
+/**
+ * aa_blend(unsigned int,unsigned int,unsigned int) - mixes color into dst
+ *                      with weight a out of 256, channel by channel.
+ */
+inline unsigned int aa_blend(unsigned int dst, unsigned int color, unsigned int a)
+{
+    unsigned int out = 0;
+    for (int shift = 0; shift<32; shift+=8)
+    {
+        unsigned int d = (dst>>shift) & 255, c = (color>>shift) & 255;
+        out |= ((d*(256-a) + c*a) >> 8) << shift;
+    }
+    return out;
+}
+
+/**
+ * aa_plot(framebuffer&,int,int,unsigned int) - bounds checked aa_blend of
+ *                      the current color into pixel (x,y).
+ */
+inline void aa_plot(framebuffer &fb, int x, int y, unsigned int a)
+{
+    unsigned int col = x - fb.left, row = y - fb.bottom;
+    if(col >= (unsigned int)fb.width || row >= (unsigned int)fb.height) return;
+
+    unsigned int &pixel = fb.pixels[(size_t)row*fb.width + col];
+    pixel = aa_blend(pixel, fb.color, a);
+}
+
+/**
+ * aa_first(const line_walk&,long long) - index of the first pixel whose
+ *                      pair starts at least k pixels off b1, i.e. whose
+ *                      offset floor(i*m/M) is at least k, or M+1 if there
+ *                      is none.
+ */
+inline long long aa_first(const line_walk &w, long long k)
+{
+    if(k <= 0) return 0;
+    if(k > w.m) return w.M+1;   /// the offset of pixel M is m
+    /// ceil(k*M/m)
+    return mul_add_div(k, w.M, w.m - 1, w.m);
+}
+
+#ifdef __AVX2__
+/**
+ * aa_blend8(__m256i,__m256i,__m256i) - aa_blend of eight pixels; a holds
+ *                      one weight per 32 bit lane.
+ */
+inline __m256i aa_blend8(__m256i dst, __m256i color, __m256i a)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i all = _mm256_set1_epi16(256);
+
+    /// every 32 bit weight becomes four 16 bit weights, one per channel,
+    /// in the same order the unpacked pixels have
+    __m256i pairs = _mm256_or_si256(a, _mm256_slli_epi32(a, 16));
+    __m256i a_lo = _mm256_unpacklo_epi32(pairs, pairs);
+    __m256i a_hi = _mm256_unpackhi_epi32(pairs, pairs);
+
+    __m256i d_lo = _mm256_unpacklo_epi8(dst, zero), d_hi = _mm256_unpackhi_epi8(dst, zero);
+    __m256i c_lo = _mm256_unpacklo_epi8(color, zero), c_hi = _mm256_unpackhi_epi8(color, zero);
+
+    __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(d_lo, _mm256_sub_epi16(all, a_lo)), _mm256_mullo_epi16(c_lo, a_lo));
+    __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(d_hi, _mm256_sub_epi16(all, a_hi)), _mm256_mullo_epi16(c_hi, a_hi));
+
+    return _mm256_packus_epi16(_mm256_srli_epi16(lo, 8), _mm256_srli_epi16(hi, 8));
+}
+#endif
+
+/**
+ * drawLinesAA(framebuffer&,const Segment*,size_t) - Wu's anti-aliased
+ *                      lines in the current color, blended over what is
+ *                      already in the framebuffer.
+ */
+inline void drawLinesAA(framebuffer &fb, const Segment *segments, size_t n)
+{
+    const int left = fb.left, bottom = fb.bottom;
+    const int right = fb.left + fb.width - 1, top = fb.bottom + fb.height - 1;
+#ifdef __AVX2__
+    const ptrdiff_t pitch = fb.width;
+    unsigned int *origin = &fb.pixels[0];
+    __m256i vcolor = _mm256_set1_epi32(fb.color);
+#endif
+
+    for (size_t k = 0; k<n; k++)
+    {
+        line_walk w = make_walk(segments[k].x1, segments[k].y1, segments[k].x2, segments[k].y2);
+
+        /// pixel i is split between the pair b1 + sign*q and b1 + sign*(q+1),
+        /// q = floor(i*m/M). Visible pixels: major co-ordinate on the surface
+        /// and the pair touching it
+        long long A0 = w.steep ? bottom : left, A1 = w.steep ? top : right;
+        long long B0 = w.steep ? left : bottom, B1 = w.steep ? right : top;
+        long long lo = w.sign>0 ? B0 - w.b1 : w.b1 - B1;
+        long long hi = w.sign>0 ? B1 - w.b1 : w.b1 - B0;
+
+        long long first = max(max(0LL, A0 - w.a1), aa_first(w, lo-1));
+        long long last = min(min(w.M, A1 - w.a1), aa_first(w, hi+1) - 1);
+        if(first > last) continue;
+
+        /// the minor offset in 1/256 pixels is pos + err/M, pos an integer
+        /// and 0 <= err < M; a pixel adds step to pos and rem to err
+        unsigned long long step = 0, rem = 0, pos = 0, err = 0;
+        if(w.M > 0)
+        {
+            step = 256*w.m / w.M;
+            rem = 256*w.m % w.M;
+            pos = mul_add_div(256*w.m, first, 0, w.M);
+            /// the terms wrap around, but the difference is below M
+            err = 256*(unsigned long long)w.m*first - pos*w.M;
+        }
+        long long i = first;
+
+#ifdef __AVX2__
+        /// the gathers need both pixels of every pair on the surface, and
+        /// the lanes keep err in 32 bits
+        long long q0 = pos >> 8, q1 = w.M > 0 ? mul_add_div(w.m, last, 0, w.M) : 0;
+        bool inside = lo <= q0 && q1+1 <= hi && w.M < (1LL << 30);
+
+        if(inside && last-first+1 >= 8)
+        {
+            ptrdiff_t major_step = w.steep ? pitch : 1, minor_step = w.steep ? w.sign : w.sign*pitch;
+            ptrdiff_t base = w.steep ? ((ptrdiff_t)w.a1-bottom)*pitch + ((ptrdiff_t)w.b1-left) : ((ptrdiff_t)w.a1-left) + ((ptrdiff_t)w.b1-bottom)*pitch;
+
+            /// lane j holds pixel i+j: pos relative to start, a multiple of
+            /// 256 so the whole pixels just add, and err; eight pixels add
+            /// step8 and rem8
+            unsigned long long start = pos & ~255ULL;
+            int lane_pos[8], lane_err[8];
+            for (int j = 0; j<8; j++)
+            {
+                lane_pos[j] = pos - start + j*step + (err + j*rem) / w.M;
+                lane_err[j] = (err + j*rem) % w.M;
+            }
+            unsigned long long step8 = 8*256*w.m / w.M, rem8 = 8*256*w.m % w.M;
+
+            __m256i vpos = _mm256_loadu_si256((const __m256i*)lane_pos);
+            __m256i verr = _mm256_loadu_si256((const __m256i*)lane_err);
+            __m256i vstep = _mm256_set1_epi32(step8), vrem = _mm256_set1_epi32(rem8);
+            __m256i vM = _mm256_set1_epi32(w.M), vlast = _mm256_set1_epi32(w.M-1);
+            __m256i vmajor = _mm256_mullo_epi32(_mm256_setr_epi32(0,1,2,3,4,5,6,7), _mm256_set1_epi32(major_step));
+            __m256i vminor = _mm256_set1_epi32(minor_step);
+            __m256i mask = _mm256_set1_epi32(255), all = _mm256_set1_epi32(256);
+            ptrdiff_t row = base + (ptrdiff_t)(start >> 8)*minor_step;
+            unsigned int at[8], px[8], px2[8];
+
+            for (; i+8<=last+1; i+=8)
+            {
+                __m256i whole = _mm256_srli_epi32(vpos, 8);
+                __m256i far_a = _mm256_and_si256(vpos, mask);
+                __m256i near_a = _mm256_sub_epi32(all, far_a);
+
+                __m256i idx = _mm256_add_epi32(_mm256_set1_epi32(row + i*major_step),
+                              _mm256_add_epi32(vmajor, _mm256_mullo_epi32(whole, vminor)));
+                __m256i idx2 = _mm256_add_epi32(idx, vminor);
+
+                __m256i near_px = aa_blend8(_mm256_i32gather_epi32((const int*)origin, idx, 4), vcolor, near_a);
+                __m256i far_px = aa_blend8(_mm256_i32gather_epi32((const int*)origin, idx2, 4), vcolor, far_a);
+
+                _mm256_storeu_si256((__m256i*)at, idx);
+                _mm256_storeu_si256((__m256i*)px, near_px);
+                _mm256_storeu_si256((__m256i*)px2, far_px);
+                for (int j = 0; j<8; j++)
+                {
+                    origin[at[j]] = px[j];
+                    origin[at[j] + minor_step] = px2[j];
+                }
+
+                /// carry: err went past M in the lanes where the mask is -1
+                vpos = _mm256_add_epi32(vpos, vstep);
+                verr = _mm256_add_epi32(verr, vrem);
+                __m256i carry = _mm256_cmpgt_epi32(verr, vlast);
+                verr = _mm256_sub_epi32(verr, _mm256_and_si256(carry, vM));
+                vpos = _mm256_sub_epi32(vpos, carry);
+            }
+
+            /// lane 0 is pixel i for the rest
+            pos = start + (unsigned int)_mm256_cvtsi256_si32(vpos);
+            err = (unsigned int)_mm256_cvtsi256_si32(verr);
+        }
+#endif
+
+        for (; i<=last; i++)
+        {
+            int whole = w.b1 + w.sign*(long long)(pos >> 8);
+            unsigned int far_a = pos & 255;
+            int a = w.a1 + i;
+
+            if(w.steep)
+            {
+                aa_plot(fb, whole, a, 256-far_a);
+                aa_plot(fb, whole+w.sign, a, far_a);
+            }
+            else
+            {
+                aa_plot(fb, a, whole, 256-far_a);
+                aa_plot(fb, a, whole+w.sign, far_a);
+            }
+
+            pos += step, err += rem;
+            if(err >= (unsigned long long)w.M) err -= w.M, pos++;
+        }
+    }
+}
+
+#endif // ANTIALIAS_H_INCLUDED
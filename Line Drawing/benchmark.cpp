@@ -0,0 +1,393 @@
+/**
+ * Throughput benchmark of the line rasterizer
+ *
+ * Draws sets of segments into a 700 x 700 software framebuffer and
+ * reports lines and pixels per second and CPU cycles per pixel of every
+ * line walk. The sets follow the distributions below (lengths, octants,
+ * axis-aligned, random), so a regression in one special case shows up
+ * on its own. The tiled rasterizer is also timed on 1, 2, 4, ... up to
+ * the given number of threads, binning on its own and the whole draw.
+ * It needs no window, so it can run on any machine.
+ *
+ * Usage: benchmark [segments] [rounds] [threads] [distribution|all]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "../Shared/framebuffer.h"
+#include "line.h"
+#include "tiled.h"
+#include "antialias.h"
+#include "blocked.h"
+#include "segfile.h"
+
+/**
+ * distribution - how the segments of a set are made. Segments of the
+ *                random set have uniformly spread endpoints. The others
+ *                have a major delta of min_length..max_length pixels and
+ *                point into the given octant (0 = east to north-east,
+ *                counter-clockwise), any octant (-1) or along an axis (-2).
+ */
+struct distribution
+{
+    const char *name;
+    int min_length, max_length;
+    int octant;
+};
+
+const int ANY_OCTANT = -1, AXIS_ALIGNED = -2;
+
+const distribution distributions[] =
+{
+    {"random", 0, 0, ANY_OCTANT},
+    {"short", 1, 16, ANY_OCTANT},
+    {"long", 400, 699, ANY_OCTANT},
+    {"axis", 1, 699, AXIS_ALIGNED},
+    {"octant0", 1, 699, 0},
+    {"octant1", 1, 699, 1},
+    {"octant2", 1, 699, 2},
+    {"octant3", 1, 699, 3},
+    {"octant4", 1, 699, 4},
+    {"octant5", 1, 699, 5},
+    {"octant6", 1, 699, 6},
+    {"octant7", 1, 699, 7},
+};
+
+const int DISTRIBUTIONS = sizeof(distributions) / sizeof(distributions[0]);
+
+/**
+ * make_segments(vector<Segment>&,size_t,unsigned,const distribution&) -
+ *                      fills the vector with n segments of the distribution,
+ *                      all of them inside the -350..349 viewport.
+ */
+void make_segments(vector<Segment> &segs, size_t n, unsigned seed, const distribution &d)
+{
+    srand(seed);
+    segs.resize(n);
+    for (size_t i = 0; i<n; i++)
+    {
+        Segment &s = segs[i];
+        if(d.max_length == 0)
+        {
+            s.x1 = rand()%700 - 350, s.y1 = rand()%700 - 350;
+            s.x2 = rand()%700 - 350, s.y2 = rand()%700 - 350;
+            continue;
+        }
+
+        int major = d.min_length + rand()%(d.max_length - d.min_length + 1);
+        int minor = d.octant == AXIS_ALIGNED ? 0 : rand()%(major+1);
+        int octant = d.octant >= 0 ? d.octant : rand()%8;
+        if(d.octant == AXIS_ALIGNED) octant = 2*(rand()%4);
+
+        /// octant 0 is (+major,+minor); each next one is 45 degrees further
+        int dx, dy;
+        switch(octant)
+        {
+            case 0: dx = major, dy = minor; break;
+            case 1: dx = minor, dy = major; break;
+            case 2: dx = -minor, dy = major; break;
+            case 3: dx = -major, dy = minor; break;
+            case 4: dx = -major, dy = -minor; break;
+            case 5: dx = -minor, dy = -major; break;
+            case 6: dx = minor, dy = -major; break;
+            default: dx = major, dy = -minor; break;
+        }
+
+        s.x1 = rand()%(700-abs(dx)) - 350 + max(0, -dx);
+        s.y1 = rand()%(700-abs(dy)) - 350 + max(0, -dy);
+        s.x2 = s.x1 + dx;
+        s.y2 = s.y1 + dy;
+    }
+}
+
+/**
+ * pixel_count(const vector<Segment>&) - number of pixels Bresenham writes
+ *                                       for the set: 1 + the major delta.
+ */
+long long pixel_count(const vector<Segment> &segs)
+{
+    long long total = 0;
+    for (size_t i = 0; i<segs.size(); i++)
+        total += 1 + max(abs(segs[i].x2-segs[i].x1), abs(segs[i].y2-segs[i].y1));
+    return total;
+}
+
+/**
+ * cycle_counter() - the time stamp counter of the CPU; 0 where there is
+ *                   none, and cycles per pixel are not printed then.
+ */
+inline unsigned long long cycle_counter()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * bench(const char*,Draw,const vector<Segment>&,int) - runs draw over the
+ *                      set several times and prints the best round.
+ */
+template <class Draw>
+void bench(const char *name, Draw draw, const vector<Segment> &segs, int rounds)
+{
+    framebuffer fb;
+    fb_init(fb, -350, -350, 700, 700);
+    fb_color(fb, 0, 1, 1);
+
+    double best = 1e100;
+    unsigned long long best_cycles = 0;
+    for (int r = 0; r<rounds; r++)
+    {
+        fb_clear(fb);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        unsigned long long cycles = cycle_counter();
+        draw(fb, &segs[0], segs.size());
+        cycles = cycle_counter() - cycles;
+        double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if(sec < best) best = sec, best_cycles = cycles;
+    }
+
+    long long pixels = pixel_count(segs);
+    printf("  %-10s %9.3f ms %9.2f Mlines/s %9.2f Mpixels/s", name, best*1e3,
+           segs.size()/best/1e6, pixels/best/1e6);
+    if(best_cycles) printf(" %7.2f cycles/pixel", (double)best_cycles/pixels);
+    printf("\n");
+}
+
+/**
+ * bench_threads(const vector<Segment>&,int,int) - drawLinesTiled on 1, 2,
+ *                      4, ... threads up to max_threads: the binning, the
+ *                      whole draw, the speedup over one thread and whether
+ *                      the image is the one of drawLines. Pools too small
+ *                      for tiling to pay off draw serially, so their row
+ *                      is the serial loop.
+ */
+void bench_threads(const vector<Segment> &segs, int rounds, int max_threads)
+{
+    framebuffer serial, fb;
+    fb_init(serial, -350, -350, 700, 700);
+    fb_init(fb, -350, -350, 700, 700);
+    fb_color(serial, 0, 1, 1);
+    fb_color(fb, 0, 1, 1);
+    drawLines(serial, &segs[0], segs.size());
+
+    double single = 0;
+    for (int t = 1; ; t = min(2*t, max_threads))
+    {
+        work_stealing_pool pool(t);
+        double binning = 1e100, drawing = 1e100;
+        for (int r = 0; r<rounds; r++)
+        {
+            tile_bins bins;
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            bin_segments(fb, &segs[0], segs.size(), bins, pool);
+            binning = min(binning, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+
+            fb_clear(fb);
+            start = chrono::steady_clock::now();
+            drawLinesTiled(fb, &segs[0], segs.size(), pool);
+            drawing = min(drawing, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        }
+        if(t == 1) single = drawing;
+
+        printf("  %3d threads binning %9.3f ms, draw %9.3f ms %6.2fx  %s\n", t, binning*1e3, drawing*1e3,
+               single/drawing, fb.pixels == serial.pixels ? "same image" : "IMAGE DIFFERS");
+        if(t >= max_threads) break;
+    }
+}
+
+/**
+ * bench_loading(const vector<Segment>&) - writes the set as a binary and a
+ *                      text segment file and times reading them back, next
+ *                      to drawing the set once, so loading can be compared
+ *                      with rasterizing. The files are removed afterwards.
+ */
+void bench_loading(const vector<Segment> &segs)
+{
+    const char *binary = "benchmark.seg", *text = "benchmark.txt";
+    if(!write_segments(binary, &segs[0], segs.size())) return;
+
+    FILE *fp = fopen(text, "w");
+    if(fp == NULL) return;
+    for (size_t i = 0; i<segs.size(); i++)
+        fprintf(fp, "%d %d %d %d\n", segs[i].x1, segs[i].y1, segs[i].x2, segs[i].y2);
+    fclose(fp);
+
+    framebuffer fb;
+    fb_init(fb, -350, -350, 700, 700);
+    segment_file f;
+
+    const char *names[2] = {"mmap", "text"}, *paths[2] = {binary, text};
+    for (int k = 0; k<2; k++)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if(!open_segments(f, paths[k])) continue;
+        double open_sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        size_t bytes = f.size;
+
+        start = chrono::steady_clock::now();
+        drawLines(fb, f.segments, f.count);
+        double draw_sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        printf("  %-10s load %9.3f ms %9.2f Msegments/s %9.1f MB/s, then draw %9.3f ms%s\n", names[k],
+               open_sec*1e3, f.count/open_sec/1e6, bytes/open_sec/1e6, draw_sec*1e3,
+               f.count == segs.size() ? "" : " (segments lost!)");
+        close_segments(f);
+    }
+
+    remove(binary);
+    remove(text);
+}
+
+/**
+ * position_error(line_kernel,const vector<Segment>&) - image quality of a
+ *                      kernel. Each segment is drawn white on black; in
+ *                      every column (row for steep segments) the intensity
+ *                      weighted centre is compared with the ideal line.
+ *                      Returns the RMS distance in pixels: an aliased line
+ *                      is off by up to half a pixel, a perfect one by 0.
+ *                      Only columns whose neighbourhood of the line is on
+ *                      the framebuffer are measured, so the segments may
+ *                      be far longer than it. An empty column counts as
+ *                      3 pixels off.
+ */
+double position_error(line_kernel draw, const vector<Segment> &segs)
+{
+    framebuffer fb;
+    fb_init(fb, -350, -350, 700, 700);
+    fb_color(fb, 1, 1, 1);
+
+    double sum = 0;
+    long long samples = 0;
+    for (size_t k = 0; k<segs.size(); k++)
+    {
+        const Segment &s = segs[k];
+        bool steep = llabs((long long)s.y2-s.y1) > llabs((long long)s.x2-s.x1);
+        long long a1 = steep ? s.y1 : s.x1, a2 = steep ? s.y2 : s.x2;
+        long long b1 = steep ? s.x1 : s.y1, b2 = steep ? s.x2 : s.y2;
+        if(a1 == a2) continue;
+
+        fb_clear(fb);
+        draw(fb, &s, 1);
+
+        long long A0 = steep ? fb.bottom : fb.left, A1 = A0 + (steep ? fb.height : fb.width) - 1;
+        long long B0 = steep ? fb.left : fb.bottom, B1 = B0 + (steep ? fb.width : fb.height) - 1;
+        for (long long a = max(min(a1,a2), A0); a<=min(max(a1,a2), A1); a++)
+        {
+            double ideal = b1 + (double)(b2-b1)*(a-a1)/(a2-a1);
+            if(ideal-2 < B0 || ideal+3 > B1) continue;
+            double weight = 0, centre = 0;
+            for (int b = (int)floor(ideal)-2; b<=(int)floor(ideal)+3; b++)
+            {
+                int x = steep ? b : (int)a, y = steep ? (int)a : b;
+                double w = (fb.pixels[(size_t)(y-fb.bottom)*fb.width + (x-fb.left)] & 255) / 255.0;
+                weight += w;
+                centre += w*b;
+            }
+            /// a column the kernel missed counts as 3 pixels off
+            double off = weight == 0 ? 3 : centre/weight - ideal;
+            sum += off*off;
+            samples++;
+        }
+    }
+    return sqrt(sum / max(samples, 1LL));
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = argc>1 ? atol(argv[1]) : 100000;
+    int rounds = argc>2 ? atoi(argv[2]) : 10;
+    work_stealing_pool pool(argc>3 ? atoi(argv[3]) : thread::hardware_concurrency());
+    const char *only = argc>4 ? argv[4] : "all";
+
+    char tiled_name[32];
+    sprintf(tiled_name, "tiled x%d", pool.size());
+    auto tiled = [&](framebuffer &fb, const Segment *s, size_t k) { drawLinesTiled(fb, s, k, pool); };
+
+    vector<Segment> segs;
+    bool found = false;
+
+    for (int d = 0; d<DISTRIBUTIONS; d++)
+    {
+        if(strcmp(only, "all") != 0 && strcmp(only, distributions[d].name) != 0) continue;
+        found = true;
+
+        make_segments(segs, n, 2015, distributions[d]);
+        printf("%s: %lu segments, %lld pixels, best of %d rounds\n", distributions[d].name,
+               (unsigned long)n, pixel_count(segs), rounds);
+        for (int k = 0; k<LINE_KERNELS; k++)
+            bench(line_kernels[k].name, line_kernels[k].draw, segs, rounds);
+        bench(tiled_name, tiled, segs, rounds);
+    }
+
+    if(!found)
+    {
+        printf("Unknown distribution %s; one of: all", only);
+        for (int d = 0; d<DISTRIBUTIONS; d++)
+            printf(" %s", distributions[d].name);
+        printf("\n");
+        return EXIT_FAILURE;
+    }
+    if(strcmp(only, "all") != 0) return EXIT_SUCCESS;
+
+    printf("fastest exact kernel on this CPU: %s\n", line_kernels[fastest_line_kernel()].name);
+
+    /// steep segments are where the row-major layout hurts most
+    block_framebuffer blocks;
+    bf_init(blocks, -350, -350, 700, 700);
+    auto blocked = [&](framebuffer &fb, const Segment *s, size_t k) { blocks.color = fb.color; drawLinesBlocked(blocks, s, k); };
+    auto resolved = [&](framebuffer &fb, const Segment *s, size_t k) { blocked(fb, s, k); bf_resolve(blocks, fb); };
+
+    for (int d = 0; d<DISTRIBUTIONS; d++)
+    {
+        if(strcmp(distributions[d].name, "octant1") != 0 && strcmp(distributions[d].name, "octant6") != 0) continue;
+
+        make_segments(segs, n, 2015, distributions[d]);
+        printf("%dx%d blocks vs row-major, %s\n", BLOCK, BLOCK, distributions[d].name);
+        bench("row-major", drawLines, segs, rounds);
+        bench("blocked", blocked, segs, rounds);
+        bench("+resolve", resolved, segs, rounds);
+    }
+
+    make_segments(segs, n, 2015, distributions[0]);
+    printf("tiled on more threads, random segments\n");
+    bench("bresenham", drawLines, segs, rounds);
+    bench_threads(segs, rounds, pool.size());
+
+    printf("loading %lu random segments from a file\n", (unsigned long)n);
+    bench_loading(segs);
+
+#ifdef __AVX2__
+    printf("anti-aliased (Wu, AVX2) vs aliased, random segments\n");
+#else
+    printf("anti-aliased (Wu, scalar) vs aliased, random segments\n");
+#endif
+    bench("bresenham", drawLines, segs, rounds);
+    bench("wu", drawLinesAA, segs, rounds);
+
+    segs.resize(min(segs.size(), (size_t)500));
+    printf("  RMS position error: bresenham %.3f px, wu %.3f px\n",
+           position_error(drawLines, segs), position_error(drawLinesAA, segs));
+
+    /// up to a billion pixels either way of a point on the framebuffer, so
+    /// the kernels have to enter the viewport exactly
+    for (size_t i = 0; i<segs.size(); i++)
+    {
+        Segment &s = segs[i];
+        int px = rand()%700 - 350, py = rand()%700 - 350;
+        s.x1 = (rand()%2000001 - 1000000) * 1000 + rand()%1000;
+        s.y1 = (rand()%2000001 - 1000000) * 1000 + rand()%1000;
+        s.x2 = 2*px - s.x1;
+        s.y2 = 2*py - s.y1;
+    }
+    printf("  RMS position error, segments of up to 2e9 pixels: bresenham %.3f px, wu %.3f px\n",
+           position_error(drawLines, segs), position_error(drawLinesAA, segs));
+
+    return EXIT_SUCCESS;
+}
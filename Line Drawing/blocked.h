@@ -0,0 +1,190 @@
+#ifndef BLOCKED_H_INCLUDED
+#define BLOCKED_H_INCLUDED
+
+/**
+ * Block-linear framebuffer layout
+ *
+ * In the row-major framebuffer two vertically neighbouring pixels are a
+ * whole row (700 * 4 bytes) apart, so a steep segment touches a new cache
+ * line with every pixel. Here the surface is stored as BLOCK x BLOCK
+ * blocks, each one contiguous and row-major inside, and the blocks in
+ * row-major order. Eight pixels of a block column share 256 bytes, so a
+ * steep walk stays in the same few cache lines for eight rows; a shallow
+ * walk still writes eight neighbours per block row.
+ *
+ * Nothing but the plotting knows about the layout: pixels go in through
+ * bf_set_pixel or drawLinesBlocked, and bf_resolve turns the surface into
+ * an ordinary framebuffer once per frame, right before it is shown.
+ */
+#include <stddef.h>
+#include <cstring>
+#include <vector>
+#include "../Shared/framebuffer.h"
+#include "line.h"
+
+const int BLOCK_SHIFT = 3;
+const int BLOCK = 1 << BLOCK_SHIFT;
+
+/**
+ * block_framebuffer - the same surface as framebuffer, with width and
+ *                     height rounded up to whole blocks in storage. Pixel
+ *                     (col,row) of the surface is at bf_index(col,row).
+ */
+struct block_framebuffer
+{
+    int left, bottom;
+    int width, height;
+    int blocks_x, blocks_y;
+    unsigned int color;
+    vector<unsigned int> pixels;
+};
+
+/**
+ * bf_init(block_framebuffer&,int,int,int,int) - fb_init of the layout.
+ */
+inline void bf_init(block_framebuffer &bf, int left, int bottom, int width, int height)
+{
+    bf.left = left;
+    bf.bottom = bottom;
+    bf.width = width;
+    bf.height = height;
+    bf.blocks_x = (width + BLOCK - 1) >> BLOCK_SHIFT;
+    bf.blocks_y = (height + BLOCK - 1) >> BLOCK_SHIFT;
+    bf.color = fb_rgba(1,1,1);
+    bf.pixels.assign((size_t)bf.blocks_x*bf.blocks_y*BLOCK*BLOCK, fb_rgba(0,0,0));
+}
+
+/**
+ * bf_clear(block_framebuffer&), bf_color(block_framebuffer&,float,float,float) -
+ *                      fb_clear and fb_color of the layout.
+ */
+inline void bf_clear(block_framebuffer &bf)
+{
+    fill(bf.pixels.begin(), bf.pixels.end(), fb_rgba(0,0,0));
+}
+
+inline void bf_color(block_framebuffer &bf, float r, float g, float b)
+{
+    bf.color = fb_rgba(r,g,b);
+}
+
+/**
+ * bf_blit(block_framebuffer&,const block_framebuffer&) - fb_blit of the layout.
+ */
+inline void bf_blit(block_framebuffer &dst, const block_framebuffer &src)
+{
+    copy(src.pixels.begin(), src.pixels.end(), dst.pixels.begin());
+}
+
+/**
+ * bf_index(const block_framebuffer&,unsigned int,unsigned int) - storage
+ *                      index of pixel (col,row), counted from the
+ *                      bottom-left corner of the surface.
+ */
+inline size_t bf_index(const block_framebuffer &bf, unsigned int col, unsigned int row)
+{
+    size_t block = (size_t)(row >> BLOCK_SHIFT)*bf.blocks_x + (col >> BLOCK_SHIFT);
+    return (block << (2*BLOCK_SHIFT)) | ((row & (BLOCK-1)) << BLOCK_SHIFT) | (col & (BLOCK-1));
+}
+
+/**
+ * bf_set_pixel(block_framebuffer&,int,int) - fb_set_pixel of the layout.
+ */
+inline void bf_set_pixel(block_framebuffer &bf, int x, int y)
+{
+    unsigned int col = x - bf.left, row = y - bf.bottom;
+    if(col >= (unsigned int)bf.width || row >= (unsigned int)bf.height) return;
+    bf.pixels[bf_index(bf, col, row)] = bf.color;
+}
+
+/**
+ * block_cursor - a pixel of the layout that moves one pixel at a time.
+ *                Inside a block a move is one add; only crossing a block
+ *                edge jumps to the neighbouring block.
+ */
+struct block_cursor
+{
+    size_t index;
+    unsigned int col, row;
+    size_t block_row;   /// storage distance of vertically neighbouring blocks
+
+    void right() { index += (++col & (BLOCK-1)) ? 1 : BLOCK*BLOCK - (BLOCK-1); }
+    void left()  { index -= (col-- & (BLOCK-1)) ? 1 : BLOCK*BLOCK - (BLOCK-1); }
+    void up()    { index += (++row & (BLOCK-1)) ? BLOCK : block_row - (BLOCK-1)*BLOCK; }
+    void down()  { index -= (row-- & (BLOCK-1)) ? BLOCK : block_row - (BLOCK-1)*BLOCK; }
+};
+
+/**
+ * drawLinesBlocked(block_framebuffer&,const Segment*,size_t) - drawLines
+ *                      into the block layout: same clipping, same pixels.
+ *                      The major axis always moves right or up, the minor
+ *                      one by the sign of the walk.
+ */
+inline void drawLinesBlocked(block_framebuffer &bf, const Segment *segments, size_t n)
+{
+    unsigned int *pixels = &bf.pixels[0];
+    const unsigned int color = bf.color;
+
+    for (size_t k = 0; k<n; k++)
+    {
+        const Segment &s = segments[k];
+        line_walk w = make_walk(s.x1, s.y1, s.x2, s.y2);
+
+        long long i0, i1;
+        if(!walk_clip(w, bf.left, bf.bottom, bf.left+bf.width-1, bf.bottom+bf.height-1, i0, i1)) continue;
+
+        long long dS = 2*w.m, dT = 2*(w.m-w.M);
+        long long d = walk_decision(w, i0);
+        int a = w.a1 + i0, b = w.b1 + w.sign*walk_offset(w, i0);
+
+        block_cursor c;
+        c.col = (w.steep ? b : a) - bf.left;
+        c.row = (w.steep ? a : b) - bf.bottom;
+        c.index = bf_index(bf, c.col, c.row);
+        c.block_row = (size_t)bf.blocks_x*BLOCK*BLOCK;
+
+        for (long long i = i0; ; i++)
+        {
+            pixels[c.index] = color;
+            if(i == i1) break;
+
+            if(w.steep) c.up();
+            else c.right();
+
+            if(d<0) d+=dS;
+            else
+            {
+                d+=dT;
+                if(w.steep) w.sign>0 ? c.right() : c.left();
+                else w.sign>0 ? c.up() : c.down();
+            }
+        }
+    }
+}
+
+/**
+ * bf_resolve(const block_framebuffer&,framebuffer&) - copies the surface
+ *                      into a row-major framebuffer of the same size. Each
+ *                      row of a block is BLOCK contiguous pixels in both,
+ *                      so it is one short memcpy.
+ */
+inline void bf_resolve(const block_framebuffer &bf, framebuffer &fb)
+{
+    const unsigned int *src = &bf.pixels[0];
+    unsigned int *dst = &fb.pixels[0];
+    int full = bf.width >> BLOCK_SHIFT, rest = bf.width & (BLOCK-1);
+
+    for (int row = 0; row<bf.height; row++)
+    {
+        const unsigned int *block = src + ((size_t)(row >> BLOCK_SHIFT)*bf.blocks_x << (2*BLOCK_SHIFT))
+                                        + ((row & (BLOCK-1)) << BLOCK_SHIFT);
+        unsigned int *line = dst + (size_t)row*fb.width;
+
+        for (int bx = 0; bx<full; bx++)
+            memcpy(line + (bx << BLOCK_SHIFT), block + (bx << (2*BLOCK_SHIFT)), BLOCK*sizeof(unsigned int));
+        if(rest)
+            memcpy(line + (full << BLOCK_SHIFT), block + (full << (2*BLOCK_SHIFT)), rest*sizeof(unsigned int));
+    }
+}
+
+#endif // BLOCKED_H_INCLUDED
@@ -0,0 +1,217 @@
+#ifndef CIRCLE_H_INCLUDED
+#define CIRCLE_H_INCLUDED
+
+/**
+ * Midpoint circle and ellipse rasterization
+ *
+ * Integer only, like the Bresenham lines. The decision variable walks one
+ * octant of a circle (one quadrant of an ellipse) and symmetry gives the
+ * rest: every decision places 8 (4) outline pixels. No pixel is plotted
+ * twice, also not on the axes and diagonals.
+ *
+ * The filled variants emit each row of the shape once, as one horizontal
+ * span(y, xl, xr). For a circle one decision step gives the rows at
+ * distance x and y from the centre; the width of a row is the widest
+ * outline pixel on it, so it is the outline filled in.
+ */
+#include "../Shared/framebuffer.h"
+
+/**
+ * circle_points(int,int,int,Plot&) - calls plot(x,y) for every pixel of
+ *                      the circle outline around (xc,yc) with radius r.
+ */
+template <class Plot>
+inline void circle_points(int xc, int yc, int r, Plot &plot)
+{
+    if(r < 0) return;
+
+    int x = 0, y = r, d = 1 - r;
+    while(x <= y)
+    {
+        plot(xc+x, yc+y);
+        if(y > 0) plot(xc+x, yc-y);
+        if(x > 0) plot(xc-x, yc+y), plot(xc-x, yc-y);
+        if(x < y)
+        {
+            plot(xc+y, yc+x), plot(xc-y, yc+x);
+            if(x > 0) plot(xc+y, yc-x), plot(xc-y, yc-x);
+        }
+
+        if(d < 0) d += 2*x + 3;
+        else d += 2*(x-y) + 5, y--;
+        x++;
+    }
+}
+
+/**
+ * circle_spans(int,int,int,Span&) - calls span(y,xl,xr) once for every
+ *                      row of the filled circle.
+ */
+template <class Span>
+inline void circle_spans(int xc, int yc, int r, Span &span)
+{
+    if(r < 0) return;
+
+    int x = 0, y = r, d = 1 - r;
+    while(x <= y)
+    {
+        /// the row at distance x is y wide
+        span(yc+x, xc-y, xc+y);
+        if(x > 0) span(yc-x, xc-y, xc+y);
+
+        if(d < 0) d += 2*x + 3;
+        else
+        {
+            /// y is left now, so x is the widest pixel of the row at distance y
+            if(x < y) span(yc+y, xc-x, xc+x), span(yc-y, xc-x, xc+x);
+            d += 2*(x-y) + 5, y--;
+        }
+        x++;
+    }
+}
+
+/**
+ * ellipse_quadrant(int,int,Visit&) - walks the first quadrant of the
+ *                      axis-aligned ellipse with radii a, b from (0,b) to
+ *                      (a,0) and calls visit(x,y) for every pixel. x never
+ *                      decreases and y never increases on the way.
+ *
+ * Region 1 is where the slope is above -1 and x steps every time; region 2
+ * is the rest and y steps every time. The decision variables are scaled by
+ * 4 so that the quarter pixel midpoints stay integers.
+ */
+template <class Visit>
+inline void ellipse_quadrant(int a, int b, Visit &visit)
+{
+    long long a2 = (long long)a*a, b2 = (long long)b*b;
+    long long x = 0, y = b;
+
+    long long d = 4*b2 - 4*a2*b + a2;
+    while(b2*x < a2*y)
+    {
+        visit(x, y);
+        x++;
+        if(d < 0) d += 8*b2*x + 4*b2;
+        else y--, d += 8*b2*x - 8*a2*y + 4*b2;
+    }
+
+    d = b2*(2*x+1)*(2*x+1) + 4*a2*(y-1)*(y-1) - 4*a2*b2;
+    while(y >= 0)
+    {
+        visit(x, y);
+        y--;
+        if(d > 0) d += 4*a2 - 8*a2*y;
+        else x++, d += 8*b2*x - 8*a2*y + 4*a2;
+    }
+
+    /// very flat ellipses leave region 2 before reaching (a,0)
+    for (x++; x<=a; x++)
+        visit(x, 0);
+}
+
+template <class Plot>
+struct ellipse_plotter
+{
+    int xc, yc;
+    Plot &plot;
+    ellipse_plotter(int x, int y, Plot &p) : xc(x), yc(y), plot(p) {}
+
+    void operator()(int x, int y)
+    {
+        plot(xc+x, yc+y);
+        if(x > 0) plot(xc-x, yc+y);
+        if(y > 0) plot(xc+x, yc-y);
+        if(x > 0 && y > 0) plot(xc-x, yc-y);
+    }
+};
+
+template <class Span>
+struct ellipse_spanner
+{
+    int xc, yc, row, width;
+    Span &span;
+    ellipse_spanner(int x, int y, int b, Span &s) : xc(x), yc(y), row(b), width(0), span(s) {}
+
+    /// rows come in order and x only grows, so a row ends when y changes
+    void operator()(int x, int y)
+    {
+        if(y != row) flush();
+        row = y;
+        width = x;
+    }
+
+    void flush()
+    {
+        span(yc+row, xc-width, xc+width);
+        if(row > 0) span(yc-row, xc-width, xc+width);
+    }
+};
+
+/**
+ * ellipse_points(int,int,int,int,Plot&) - calls plot(x,y) for every pixel
+ *                      of the outline of the ellipse around (xc,yc) with
+ *                      radii a (along x) and b (along y).
+ */
+template <class Plot>
+inline void ellipse_points(int xc, int yc, int a, int b, Plot &plot)
+{
+    if(a < 0 || b < 0) return;
+
+    ellipse_plotter<Plot> quadrant(xc, yc, plot);
+    ellipse_quadrant(a, b, quadrant);
+}
+
+/**
+ * ellipse_spans(int,int,int,int,Span&) - calls span(y,xl,xr) once for
+ *                      every row of the filled ellipse.
+ */
+template <class Span>
+inline void ellipse_spans(int xc, int yc, int a, int b, Span &span)
+{
+    if(a < 0 || b < 0) return;
+
+    ellipse_spanner<Span> rows(xc, yc, b, span);
+    ellipse_quadrant(a, b, rows);
+    rows.flush();
+}
+
+/**
+ * fb_pixel_sink, fb_span_sink - plot and span functors writing the
+ *                               current color into a framebuffer.
+ */
+struct fb_pixel_sink
+{
+    framebuffer &fb;
+    fb_pixel_sink(framebuffer &f) : fb(f) {}
+    void operator()(int x, int y) { fb_set_pixel(fb, x, y); }
+};
+
+struct fb_span_sink
+{
+    framebuffer &fb;
+    fb_span_sink(framebuffer &f) : fb(f) {}
+    void operator()(int y, int xl, int xr) { fb_span(fb, y, xl, xr); }
+};
+
+/**
+ * fb_circle(framebuffer&,int,int,int,bool), fb_ellipse(framebuffer&,int,
+ *           int,int,int,bool) - outline or filled shape in the current
+ *                      color; filled rows go through fb_span.
+ */
+inline void fb_circle(framebuffer &fb, int xc, int yc, int r, bool filled)
+{
+    fb_pixel_sink plot(fb);
+    fb_span_sink span(fb);
+    if(filled) circle_spans(xc, yc, r, span);
+    else circle_points(xc, yc, r, plot);
+}
+
+inline void fb_ellipse(framebuffer &fb, int xc, int yc, int a, int b, bool filled)
+{
+    fb_pixel_sink plot(fb);
+    fb_span_sink span(fb);
+    if(filled) ellipse_spans(xc, yc, a, b, span);
+    else ellipse_points(xc, yc, a, b, plot);
+}
+
+#endif // CIRCLE_H_INCLUDED
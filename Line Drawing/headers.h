@@ -1,7 +1,9 @@
 #ifndef HEADERS_H_INCLUDED
 #define HEADERS_H_INCLUDED
 
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 #ifdef __APPLE__
 #include <GLUT/glut.h>
@@ -0,0 +1,622 @@
+#ifndef LINE_H_INCLUDED
+#define LINE_H_INCLUDED
+
+/**
+ * All-octant Bresenham line rasterization
+ *
+ * Integer only. Every segment is turned around so that it is walked in
+ * increasing direction of its major axis, so for 0 <= m <= 1 the pixels
+ * are exactly the ones of the classic loop in bresenham_algo.
+ *
+ * Segments are clipped to the viewport in integer space before they are
+ * walked: the first visible pixel and its decision variable come from
+ * closed forms (line_walk), so the pixels are the same as walking the
+ * whole segment while the cost depends only on the visible length.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <chrono>
+#include "../Shared/framebuffer.h"
+
+/**
+ * Segment - one line segment in integer pixel co-ordinates.
+ */
+struct Segment
+{
+    int x1, y1, x2, y2;
+};
+
+/**
+ * pixel_round(double,int&) - the nearest pixel co-ordinate, halves rounded
+ *                      up; every input path rounds through it. Returns
+ *                      false for values off the int range, and NaN, which
+ *                      have no pixel.
+ */
+inline bool pixel_round(double v, int &pixel)
+{
+    double r = floor(v + 0.5);
+    if(!(r >= INT_MIN && r <= INT_MAX)) return false;
+    pixel = (int)r;
+    return true;
+}
+
+/**
+ * round_segment(const double*,Segment&) - the segment of the endpoints
+ *                      v[0..3] = x1 y1 x2 y2; false if one of them is off
+ *                      the int range.
+ */
+inline bool round_segment(const double *v, Segment &s)
+{
+    return pixel_round(v[0], s.x1) && pixel_round(v[1], s.y1) && pixel_round(v[2], s.x2) && pixel_round(v[3], s.y2);
+}
+
+/**
+ * line_walk - a segment in the normalized form the Bresenham loop walks
+ *             it: pixel i (0 <= i <= M) is at a1+i on the major axis and
+ *             at b1 + sign*offset(i) on the minor axis, where
+ *             offset(i) = floor((2*m*i + M) / (2*M)).
+ *             M and m go up to 2^32 for int endpoints, so the products
+ *             of the closed forms below need up to 66 bits; they are
+ *             taken in 128 bits (mul_add_div) and exact for any int
+ *             endpoints.
+ */
+struct line_walk
+{
+    int a1, b1;
+    long long M, m;
+    int sign;
+    bool steep;
+};
+
+/**
+ * make_walk(int,int,int,int) - normalizes a segment exactly the way the
+ *                              Bresenham loops in this file do.
+ */
+inline line_walk make_walk(int x1, int y1, int x2, int y2)
+{
+    line_walk w;
+    long long dx = (long long)x2-x1, dy = (long long)y2-y1;
+    w.steep = llabs(dy) > llabs(dx);
+
+    if(w.steep ? dy<0 : dx<0)
+    {
+        swap(x1,x2), swap(y1,y2);
+        dx = -dx, dy = -dy;
+    }
+
+    w.a1 = w.steep ? y1 : x1;
+    w.b1 = w.steep ? x1 : y1;
+    w.M = w.steep ? dy : dx;
+    w.m = w.steep ? llabs(dx) : llabs(dy);
+    w.sign = (w.steep ? dx : dy) < 0 ? -1 : 1;
+    return w;
+}
+
+/**
+ * mul_add_div(unsigned long long,unsigned long long,unsigned long long,
+ *             unsigned long long) - floor((a*b + c) / d) with the sum
+ *                      taken in 128 bits. The quotient has to fit in
+ *                      64 bits. Products of less than 2^62, which are all
+ *                      of them for viewport sized segments, take the plain
+ *                      64 bit division.
+ */
+inline unsigned long long mul_add_div(unsigned long long a, unsigned long long b, unsigned long long c, unsigned long long d)
+{
+    if(((a|b) >> 31) == 0 && c < (1ULL << 62)) return (a*b + c) / d;
+
+#ifdef __SIZEOF_INT128__
+    return ((unsigned __int128)a*b + c) / d;
+#else
+    /// a*b from 32 bit halves into hi:lo, then c, then long division
+    unsigned long long al = a & 0xffffffffULL, ah = a >> 32, bl = b & 0xffffffffULL, bh = b >> 32;
+    unsigned long long ll = al*bl, lh = al*bh, hl = ah*bl, hh = ah*bh;
+    unsigned long long mid = (ll >> 32) + (lh & 0xffffffffULL) + (hl & 0xffffffffULL);
+    unsigned long long lo = (mid << 32) | (ll & 0xffffffffULL);
+    unsigned long long hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+    lo += c;
+    hi += lo < c;
+
+    unsigned long long q = 0, r = hi % d;
+    for (int bit = 63; bit>=0; bit--)
+    {
+        bool carry = r >> 63;
+        r = (r << 1) | ((lo >> bit) & 1);
+        q <<= 1;
+        if(carry || r >= d) r -= d, q |= 1;
+    }
+    return q;
+#endif
+}
+
+/**
+ * walk_offset(const line_walk&,long long) - minor axis offset of pixel i.
+ */
+inline long long walk_offset(const line_walk &w, long long i)
+{
+    if(w.M == 0) return 0;
+    return mul_add_div(2*w.m, i, w.M, 2*w.M);
+}
+
+/**
+ * walk_first(const line_walk&,long long) - index of the first pixel whose
+ *                      minor offset is at least k, or M+1 if there is none.
+ */
+inline long long walk_first(const line_walk &w, long long k)
+{
+    if(k <= 0) return 0;
+    if(k > w.m) return w.M+1;   /// offset(M) is m
+    /// (2*M*k - M + 2*m - 1) / (2*m), with all terms made non-negative
+    return min(w.M+1, (long long)mul_add_div(2*w.M, k-1, w.M + 2*w.m - 1, 2*w.m));
+}
+
+/**
+ * walk_decision(const line_walk&,long long) - the Bresenham decision
+ *                      variable the classic loop holds at pixel i, so a
+ *                      walk can start anywhere without replaying the
+ *                      steps before it.
+ */
+inline long long walk_decision(const line_walk &w, long long i)
+{
+    /// the terms need 66 bits but the difference fits; unsigned arithmetic
+    /// wraps around without overflow and gives it exactly
+    unsigned long long m = w.m, M = w.M;
+    return (long long)(2*m*(i+1) - M - 2*M*walk_offset(w, i));
+}
+
+/**
+ * walk_clip(const line_walk&,int,int,int,int,long long&,long long&) -
+ *                      finds the pixels i0..i1 of the walk which fall into
+ *                      the rectangle [X0,X1] x [Y0,Y1]. Returns false if
+ *                      there is none. Both offset and major co-ordinate
+ *                      grow with i, so each axis gives one index interval.
+ */
+inline bool walk_clip(const line_walk &w, int X0, int Y0, int X1, int Y1, long long &i0, long long &i1)
+{
+    long long A0 = w.steep ? Y0 : X0, A1 = w.steep ? Y1 : X1;
+    long long B0 = w.steep ? X0 : Y0, B1 = w.steep ? X1 : Y1;
+
+    i0 = max(0LL, A0 - w.a1);
+    i1 = min(w.M, A1 - w.a1);
+
+    long long lo = w.sign>0 ? B0 - w.b1 : w.b1 - B1;
+    long long hi = w.sign>0 ? B1 - w.b1 : w.b1 - B0;
+
+    i0 = max(i0, walk_first(w, lo));
+    i1 = min(i1, walk_first(w, hi+1) - 1);
+    return i0 <= i1;
+}
+
+/**
+ * bresenham_line(int,int,int,int,int,int,int,int,Plot&) - calls plot(x,y)
+ *                      for every pixel of the segment inside the viewport
+ *                      [X0,X1] x [Y0,Y1]. Works for any slope; plot can be
+ *                      setPixel or any functor.
+ */
+template <class Plot>
+inline void bresenham_line(int x1, int y1, int x2, int y2, int X0, int Y0, int X1, int Y1, Plot &plot)
+{
+    line_walk w = make_walk(x1, y1, x2, y2);
+
+    long long i0, i1;
+    if(!walk_clip(w, X0, Y0, X1, Y1, i0, i1)) return;
+
+    long long dS = 2*w.m, dT = 2*(w.m-w.M);
+    long long d = walk_decision(w, i0);
+    int a = w.a1 + i0, b = w.b1 + w.sign*walk_offset(w, i0);
+
+    for (long long i = i0; ; i++)
+    {
+        if(w.steep) plot(b,a);
+        else plot(a,b);
+
+        if(i == i1) break;
+        a++;
+        if(d<0) d+=dS;
+        else b+=w.sign, d+=dT;
+    }
+}
+
+/**
+ * walk_pixels(const line_walk&,long long,long long,unsigned int*,ptrdiff_t,
+ *             int,int,unsigned int) - writes color on pixels i0..i1 of the
+ *                      walk into a pixel array with the given pitch whose
+ *                      first element is pixel (X0,Y0). The caller makes
+ *                      sure, e.g. with walk_clip, that all of them fit.
+ */
+inline void walk_pixels(const line_walk &w, long long i0, long long i1, unsigned int *base, ptrdiff_t pitch, int X0, int Y0, unsigned int color)
+{
+    long long dS = 2*w.m, dT = 2*(w.m-w.M);
+    long long d = walk_decision(w, i0);
+    int a = w.a1 + i0, b = w.b1 + w.sign*walk_offset(w, i0);
+    int x = w.steep ? b : a, y = w.steep ? a : b;
+
+    ptrdiff_t major_step = w.steep ? pitch : 1;
+    ptrdiff_t minor_step = w.steep ? w.sign : w.sign*pitch;
+    unsigned int *p = base + (ptrdiff_t)(y-Y0)*pitch + (x-X0);
+
+    *p = color;
+    for (long long i = i0; i<i1; i++)
+    {
+        p += major_step;
+        if(d<0) d+=dS;
+        else p+=minor_step, d+=dT;
+        *p = color;
+    }
+}
+
+/**
+ * draw_clipped(framebuffer&,const Segment&) - draws the visible part of a
+ *                      segment which is not fully inside the framebuffer.
+ */
+inline void draw_clipped(framebuffer &fb, const Segment &s)
+{
+    line_walk w = make_walk(s.x1, s.y1, s.x2, s.y2);
+
+    long long i0, i1;
+    if(!walk_clip(w, fb.left, fb.bottom, fb.left+fb.width-1, fb.bottom+fb.height-1, i0, i1)) return;
+
+    walk_pixels(w, i0, i1, &fb.pixels[0], fb.width, fb.left, fb.bottom, fb.color);
+}
+
+/**
+ * Stepping policies
+ *
+ * walk(p,major,minor,major_step,minor_step,color) writes the major+1
+ * pixels of one normalized segment (major >= minor >= 0) starting at p.
+ * A step along the major axis moves p by major_step, a step along the
+ * minor axis by minor_step. The policy is a template argument of
+ * drawLinesWith, so the call is resolved at compile time and inlined.
+ */
+
+/**
+ * bresenham_step - the classic loop: one decision per pixel.
+ */
+struct bresenham_step
+{
+    static void walk(unsigned int *p, int major, int minor, ptrdiff_t major_step, ptrdiff_t minor_step, unsigned int color)
+    {
+        int dS = 2*minor, dT = 2*(minor-major);
+        int d = 2*minor - major;
+
+        *p = color;
+        for (int i = 0; i<major; i++)
+        {
+            p += major_step;
+            if(d<0) d+=dS;
+            else p+=minor_step, d+=dT;
+            *p = color;
+        }
+    }
+};
+
+/**
+ * double_step - Wu's double-step: one decision picks the pattern of the
+ *               next two pixels. For slopes up to 1/2 the patterns are
+ *               (flat,flat), (flat,up) and (up,flat); above 1/2 they are
+ *               (flat,up), (up,flat) and (up,up). The decision variable
+ *               is the classic one advanced by two steps, so the pixels
+ *               are exactly those of bresenham_step.
+ */
+struct double_step
+{
+    static void walk(unsigned int *p, int major, int minor, ptrdiff_t major_step, ptrdiff_t minor_step, unsigned int color)
+    {
+        int dS = 2*minor, dT = 2*(minor-major);
+        int d = 2*minor - major;
+        int pairs = major/2;
+
+        *p = color;
+        if(2*minor <= major)
+        {
+            for (int i = 0; i<pairs; i++)
+            {
+                if(d < -dS)
+                {
+                    p[major_step] = color;
+                    p += 2*major_step;
+                    d += 2*dS;
+                }
+                else if(d < 0)
+                {
+                    p[major_step] = color;
+                    p += 2*major_step + minor_step;
+                    d += dS + dT;
+                }
+                else
+                {
+                    p[major_step + minor_step] = color;
+                    p += 2*major_step + minor_step;
+                    d += dT + dS;
+                }
+                *p = color;
+            }
+        }
+        else
+        {
+            for (int i = 0; i<pairs; i++)
+            {
+                if(d < 0)
+                {
+                    p[major_step] = color;
+                    p += 2*major_step + minor_step;
+                    d += dS + dT;
+                }
+                else if(d < -dT)
+                {
+                    p[major_step + minor_step] = color;
+                    p += 2*major_step + minor_step;
+                    d += dT + dS;
+                }
+                else
+                {
+                    p[major_step + minor_step] = color;
+                    p += 2*(major_step + minor_step);
+                    d += 2*dT;
+                }
+                *p = color;
+            }
+        }
+
+        if(major & 1)
+        {
+            p += major_step;
+            if(d >= 0) p += minor_step;
+            *p = color;
+        }
+    }
+};
+
+/**
+ * dda_step - 16.16 fixed-point DDA: the minor co-ordinate is a fraction
+ *            which grows by minor/major every pixel and a minor step is
+ *            taken on each carry out of the low 16 bits. No decision
+ *            variable at all, but the slope is rounded to 16 bits, so on
+ *            long segments a pixel may differ from Bresenham.
+ */
+struct dda_step
+{
+    static void walk(unsigned int *p, int major, int minor, ptrdiff_t major_step, ptrdiff_t minor_step, unsigned int color)
+    {
+        unsigned int slope = major ? (unsigned int)(((unsigned long long)minor << 16) / major) : 0;
+        unsigned int frac = 0x8000;
+
+        *p = color;
+        for (int i = 0; i<major; i++)
+        {
+            frac += slope;
+            p += major_step + (frac >> 16)*minor_step;
+            frac &= 0xffff;
+            *p = color;
+        }
+    }
+};
+
+/**
+ * drawLinesWith<Step>(framebuffer&,const Segment*,size_t) - rasterizes n
+ *                      segments into the framebuffer with the current
+ *                      color, using the stepping policy Step.
+ *
+ * The surface geometry is read once per call. A segment which is fully
+ * inside the surface is walked with a raw pixel pointer: one step along
+ * the major axis plus an optional step along the minor axis, both being
+ * precomputed pointer offsets, so the inner loop has no bounds checks and
+ * no octant branches. Segments crossing the border are clipped first.
+ */
+template <class Step>
+inline void drawLinesWith(framebuffer &fb, const Segment *segments, size_t n)
+{
+    const int left = fb.left, bottom = fb.bottom;
+    const int right = fb.left + fb.width - 1, top = fb.bottom + fb.height - 1;
+    const ptrdiff_t pitch = fb.width;
+    const unsigned int color = fb.color;
+    unsigned int *origin = &fb.pixels[0];
+
+    for (size_t k = 0; k<n; k++)
+    {
+        int x1 = segments[k].x1, y1 = segments[k].y1;
+        int x2 = segments[k].x2, y2 = segments[k].y2;
+
+        if(min(x1,x2)<left || max(x1,x2)>right || min(y1,y2)<bottom || max(y1,y2)>top)
+        {
+            draw_clipped(fb, segments[k]);
+            continue;
+        }
+
+        int dx = x2-x1, dy = y2-y1;
+        bool steep = abs(dy) > abs(dx);
+
+        if(steep ? dy<0 : dx<0)
+        {
+            swap(x1,x2), swap(y1,y2);
+            dx = -dx, dy = -dy;
+        }
+
+        int major = steep ? dy : dx;
+        int minor = steep ? abs(dx) : abs(dy);
+        int minor_sign = (steep ? dx : dy) < 0 ? -1 : 1;
+
+        ptrdiff_t major_step = steep ? pitch : 1;
+        ptrdiff_t minor_step = steep ? minor_sign : minor_sign*pitch;
+        unsigned int *p = origin + (ptrdiff_t)(y1-bottom)*pitch + (x1-left);
+
+        Step::walk(p, major, minor, major_step, minor_step, color);
+    }
+}
+
+/**
+ * drawLines(framebuffer&,const Segment*,size_t) - the classic Bresenham
+ *                      kernel; reference output of every other one.
+ */
+inline void drawLines(framebuffer &fb, const Segment *segments, size_t n)
+{
+    drawLinesWith<bresenham_step>(fb, segments, n);
+}
+
+/**
+ * drawLinesRunSlice(framebuffer&,const Segment*,size_t) - the run-slice
+ *                      variant of drawLines. Same pixels, different walk.
+ *
+ * Pixel i of a mostly horizontal segment (minor m, major M) sits on row
+ * floor((2*m*i + M) / (2*M)), so row j+1 starts at pixel
+ * ceil((2*M*j + M) / (2*m)). That quotient is kept as whole part plus
+ * remainder and advanced by the constant 2*M / 2*m every row, so each run
+ * length costs O(1) additions and the run itself is written by one
+ * fb_fill_row. Steep segments have single pixel runs and keep the classic
+ * loop; segments crossing the border are clipped first.
+ */
+inline void drawLinesRunSlice(framebuffer &fb, const Segment *segments, size_t n)
+{
+    const int left = fb.left, bottom = fb.bottom;
+    const int right = fb.left + fb.width - 1, top = fb.bottom + fb.height - 1;
+    const ptrdiff_t pitch = fb.width;
+    const unsigned int color = fb.color;
+    unsigned int *origin = &fb.pixels[0];
+
+    for (size_t k = 0; k<n; k++)
+    {
+        int x1 = segments[k].x1, y1 = segments[k].y1;
+        int x2 = segments[k].x2, y2 = segments[k].y2;
+
+        if(min(x1,x2)<left || max(x1,x2)>right || min(y1,y2)<bottom || max(y1,y2)>top)
+        {
+            draw_clipped(fb, segments[k]);
+            continue;
+        }
+
+        if(abs(y2-y1) > abs(x2-x1))
+        {
+            drawLines(fb, &segments[k], 1);
+            continue;
+        }
+
+        if(x2<x1) swap(x1,x2), swap(y1,y2);
+
+        int M = x2-x1, m = abs(y2-y1);
+        ptrdiff_t row_step = (y2<y1) ? -pitch : pitch;
+        unsigned int *p = origin + (ptrdiff_t)(y1-bottom)*pitch + (x1-left);
+
+        if(m == 0)
+        {
+            fb_fill_row(p, M+1, color);
+            continue;
+        }
+
+        /// next = index of the first pixel of the next row = ceil(num / (2m))
+        int D = 2*m;
+        int q = M / D, r = M % D;
+        int Q = (2*M) / D, R = (2*M) % D;
+        int start = 0;
+
+        for (int j = 0; j<m; j++)
+        {
+            int next = q + (r>0);
+            fb_fill_row(p, next-start, color);
+            p += (next-start) + row_step;
+            start = next;
+
+            q += Q, r += R;
+            if(r >= D) q++, r -= D;
+        }
+        fb_fill_row(p, M+1-start, color);
+    }
+}
+
+/**
+ * line_kernels - every line kernel by name. The exact ones draw the same
+ *                pixels as drawLines and can replace it freely; which of
+ *                them is fastest depends on the CPU.
+ */
+typedef void (*line_kernel)(framebuffer&, const Segment*, size_t);
+
+struct line_kernel_entry
+{
+    const char *name;
+    line_kernel draw;
+    bool exact;
+};
+
+const line_kernel_entry line_kernels[] =
+{
+    {"bresenham", drawLinesWith<bresenham_step>, true},
+    {"double", drawLinesWith<double_step>, true},
+    {"runslice", drawLinesRunSlice, true},
+    {"dda", drawLinesWith<dda_step>, false},
+};
+const int LINE_KERNELS = sizeof(line_kernels) / sizeof(line_kernels[0]);
+
+/**
+ * find_line_kernel(const char*) - kernel with the given name, or NULL.
+ */
+inline line_kernel find_line_kernel(const char *name)
+{
+    for (int i = 0; i<LINE_KERNELS; i++)
+        if(strcmp(line_kernels[i].name, name) == 0) return line_kernels[i].draw;
+    return NULL;
+}
+
+/**
+ * viewport_random(unsigned int&) - small LCG giving a co-ordinate in
+ *                                  -350..349 without touching rand().
+ */
+inline int viewport_random(unsigned int &seed)
+{
+    seed = seed*1103515245 + 12345;
+    return (seed>>16)%700 - 350;
+}
+
+/// timed runs per kernel in fastest_line_kernel, after one warm-up pass
+const int KERNEL_TIMING_RUNS = 5;
+
+/**
+ * fastest_line_kernel(int) - times every exact kernel on the same random
+ *                      segments in a scratch 700 x 700 surface and
+ *                      returns the index of the fastest one. Every kernel
+ *                      draws once untimed, so the surface is paged in and
+ *                      the code is hot; then each takes its best of
+ *                      KERNEL_TIMING_RUNS runs, interleaved so a slow
+ *                      moment of the machine hits them all alike.
+ */
+inline int fastest_line_kernel(int segments_to_time = 5000)
+{
+    framebuffer fb;
+    fb_init(fb, -350, -350, 700, 700);
+
+    vector<Segment> segs(segments_to_time);
+    unsigned int seed = 2015;
+    for (int i = 0; i<segments_to_time; i++)
+    {
+        segs[i].x1 = viewport_random(seed);
+        segs[i].y1 = viewport_random(seed);
+        segs[i].x2 = viewport_random(seed);
+        segs[i].y2 = viewport_random(seed);
+    }
+
+    double times[LINE_KERNELS];
+    for (int i = 0; i<LINE_KERNELS; i++)
+    {
+        times[i] = 1e100;
+        if(line_kernels[i].exact) line_kernels[i].draw(fb, &segs[0], segs.size());
+    }
+
+    for (int run = 0; run<KERNEL_TIMING_RUNS; run++)
+        for (int i = 0; i<LINE_KERNELS; i++)
+        {
+            if(!line_kernels[i].exact) continue;
+
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            line_kernels[i].draw(fb, &segs[0], segs.size());
+            double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+            times[i] = min(times[i], sec);
+        }
+
+    int best = 0;
+    for (int i = 0; i<LINE_KERNELS; i++)
+        if(line_kernels[i].exact && times[i] < times[best]) best = i;
+    return best;
+}
+
+#endif // LINE_H_INCLUDED
@@ -7,8 +7,90 @@
  * using Bresenham's line Algorithm.
  */
 #include "headers.h"
+#include "../Shared/framebuffer.h"
+#include "line.h"
+#include "tiled.h"
+#include "antialias.h"
+#include "blocked.h"
+#include "circle.h"
+#include "stroke.h"
+#include "segfile.h"
+#include "overdraw.h"
 
-double x1, y1, x2, y2;
+vector<Segment> segments;
+
+/**
+ * Segments of a file given with -input. A binary file is drawn straight
+ * from its memory mapping.
+ */
+const char *input_path = NULL;
+segment_file input;
+
+/**
+ * Curve - a circle (rx == ry) or axis-aligned ellipse given on the command
+ *         line, drawn as outline or, with fill_curves, filled.
+ */
+struct Curve
+{
+    int xc, yc, rx, ry;
+};
+
+vector<Curve> curves;
+bool fill_curves = false;
+
+/**
+ * With stroking set (-stroke), the input is a polyline which is drawn
+ * stroke.width pixels wide instead of the single segment.
+ */
+bool stroking = false;
+stroke_style stroke = {1, false, 4};
+vector<Vertex> polyline;
+
+/**
+ * When software_backend is set, every pixel goes into the in-memory
+ * framebuffer "screen" instead of OpenGL. The surface is flushed to the
+ * window once per frame, or dumped to headless_output when there is no
+ * window at all.
+ */
+bool software_backend = false;
+line_kernel kernel = drawLines;
+work_stealing_pool *pool = NULL;
+const char *headless_output = NULL;
+framebuffer screen;
+
+/**
+ * With blocked_layout the software pixels go into "blocks", stored in
+ * 8 x 8 blocks for steep lines, and are resolved into "screen" only when
+ * the frame is presented.
+ */
+bool blocked_layout = false;
+block_framebuffer blocks;
+
+/**
+ * With count_writes (-overdraw) every pixel write is counted in
+ * "overdraw" and each frame ends with an overdraw report. With blending
+ * (-blend a) the color is mixed into the pixel with weight blend_alpha
+ * out of 256 instead of replacing it. dedup_writes (-dedup) lets only the
+ * first write of a pixel through until the color changes, using the
+ * coverage mask "covered", so overlapping lines are blended once.
+ */
+bool count_writes = false, blending = false, dedup_writes = false;
+unsigned int blend_alpha = 256;
+overdraw_counter overdraw;
+coverage_mask covered;
+
+/**
+ * The OpenGL path does not draw a pixel when setPixel is called. Pixels
+ * are collected, with their color, in one vertex array per frame and
+ * flushPoints() submits all of them with a single glDrawArrays call.
+ * draw_calls counts the GL draw calls of the current frame; with
+ * print_stats (-stats) every frame prints it.
+ */
+vector<GLint> batch_xy;
+vector<GLuint> batch_rgba;
+GLuint batch_color = 0xffffffff;
+int draw_calls = 0;
+bool print_stats = false;
 
 
 /**
@@ -16,35 +98,103 @@ double x1, y1, x2, y2;
  *                     co-ordinate (x,y) on the OpenGL screen.
  */
 void setPixel(int x, int y)
-{   /**
-     * glBegin(GLbitfield mask) - delimit the vertices of a primitive or
-     *                            a group of like primitives
-     *
-     * GL_POINTS - Treats each vertex as a single point.
-     *             Vertex n defines point n. N points are drawn.
-     */
-    glBegin(GL_POINTS);
-    /**
-     * glVertex2f(float,float) - This function takes two floating
-     *                           point values of co-ordinate and
-     *                           set the point.
-     */
-    glVertex2f(x,y);
+{
+    if(count_writes) od_count(overdraw, x, y);
+    if(dedup_writes && !cm_first(covered, x, y)) return;
 
-    /**
-     * Sleep(int) - wait time in milliseconds. It is for distinguish
-     *              two operations.
-     */
-//    Sleep(10);
+    if(software_backend)
+    {
+        if(blending) aa_plot(screen, x, y, blend_alpha);
+        else if(blocked_layout) bf_set_pixel(blocks, x, y);
+        else fb_set_pixel(screen, x, y);
+        return;
+    }
+
+    batch_xy.push_back(x);
+    batch_xy.push_back(y);
+    batch_rgba.push_back(batch_color);
+}
+
+/**
+ * perPixel() - true when every write has to go through setPixel to be
+ *              counted, blended or deduplicated.
+ */
+bool perPixel(void)
+{
+    return count_writes || blending || dedup_writes;
+}
+
+/**
+ * setSpan(int,int,int) - sets the pixels xl..xr of row y. The framebuffer
+ *                        fills the whole run at once.
+ */
+void setSpan(int y, int xl, int xr)
+{
+    if(software_backend && !blocked_layout && !perPixel())
+    {
+        fb_span(screen, y, xl, xr);
+        return;
+    }
+
+    for (int x = max(xl, -350); x<=min(xr, 349); x++)
+        setPixel(x, y);
+}
+
+/**
+ * flushPoints() - draws every pixel collected by setPixel since the last
+ *                 flush with one glDrawArrays call.
+ */
+void flushPoints(void)
+{
+    if(batch_rgba.empty()) return;
 
     /**
-     * glEnd() - end of the environment created by glBegin(int)
+     * glVertexPointer / glColorPointer - tell OpenGL where the arrays of
+     *                          positions (2 ints) and colors (4 bytes)
+     *                          are; glDrawArrays(GL_POINTS, first, count)
+     *                          then draws count points out of them.
      */
-    glEnd();
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_INT, 0, &batch_xy[0]);
+    glColorPointer(4, GL_UNSIGNED_BYTE, 0, &batch_rgba[0]);
+    glDrawArrays(GL_POINTS, 0, batch_rgba.size());
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    draw_calls++;
+
+    batch_xy.clear();
+    batch_rgba.clear();
 }
 
-void bresenham_algo(void)
+/**
+ * setColor(float,float,float) - glColor3f for the active backend.
+ */
+void setColor(float r, float g, float b)
 {
+    if(dedup_writes) cm_clear(covered);
+    if(blocked_layout) bf_color(blocks, r, g, b);
+    if(software_backend) fb_color(screen, r, g, b);
+    else
+    {
+        batch_color = fb_rgba(r, g, b);
+        /// the alpha byte, for glBlendFunc
+        if(blending) ((unsigned char*)&batch_color)[3] = min(255u, blend_alpha);
+    }
+}
+
+/**
+ * clearScreen() - glClear for the active backend.
+ */
+void clearScreen(void)
+{
+    if(software_backend)
+    {
+        if(blocked_layout) bf_clear(blocks);
+        else fb_clear(screen);
+        return;
+    }
+
     /**
      * glClear(GLbitfield mask)  clear buffers to preset values
      * GL_COLOR_BUFFER_BIT - Indicates the buffers currently
@@ -52,58 +202,370 @@ void bresenham_algo(void)
      * GL_DEPTH_BUFFER_BIT - Indicates the depth buffer
      */
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+/**
+ * presentFrame() - finishes a frame. The software framebuffer is copied to
+ *                  the window with a single glDrawPixels call; in headless
+ *                  mode it is kept in memory until main() dumps it.
+ */
+void presentFrame(void)
+{
+    if(blocked_layout) bf_resolve(blocks, screen);
+
+    if(count_writes)
+    {
+        od_report(overdraw, stdout);
+        od_clear(overdraw);
+    }
+    if(dedup_writes)
+    {
+        printf("Coverage mask skipped %llu writes\n", covered.skipped);
+        covered.skipped = 0;
+    }
+    if(headless_output != NULL) return;
+
+    if(software_backend)
+    {
+        /**
+         * glRasterPos2i(int,int) - the bottom-left corner where
+         *                          glDrawPixels starts writing.
+         */
+        glRasterPos2i(screen.left, screen.bottom);
+        glDrawPixels(screen.width, screen.height, GL_RGBA, GL_UNSIGNED_BYTE, &screen.pixels[0]);
+        draw_calls++;
+    }
+    else flushPoints();
+
     /**
-     * void glColor3f(GLfloat red, GLfloat green, GLfloat blue) -
-     *          set RGB color.
+     * glutSwapBuffers() -  swaps the buffers of the current window
+     *                      if double buffered
      */
-    glColor3f(1,0,0); // cyan color
+    glutSwapBuffers();
 
-    for (int i = -350; i<=350; i++)
-        setPixel(0,i),setPixel(i,0);
+    if(print_stats) printf("Draw calls this frame: %d\n", draw_calls);
+    draw_calls = 0;
+}
 
-    glColor3f(0,1,1); // cyan color
+/**
+ * drawLines(const Segment*,size_t) - draws a batch of segments of any slope
+ *                                    with the active backend.
+ */
+void drawLines(const Segment *lines, size_t n)
+{
+    if(software_backend && !perPixel())
+    {
+        if(blocked_layout) drawLinesBlocked(blocks, lines, n);
+        else if(pool != NULL && tiled_pays_off(n, *pool)) drawLinesTiled(screen, lines, n, *pool);
+        else kernel(screen, lines, n);
+        return;
+    }
 
-    ///Main algorithm
+    for (size_t i = 0; i<n; i++)
+        bresenham_line(lines[i].x1, lines[i].y1, lines[i].x2, lines[i].y2, -350, -350, 349, 349, setPixel);
+}
 
-    int x1prime = x1+0.5;
-    int x2prime = x2+0.5;
-    int y1prime = y1+0.5;
-    int y2prime = y2+0.5;
+/**
+ * drawCurves() - midpoint circles and ellipses; outlines go through
+ *                setPixel, filled ones row by row through setSpan.
+ */
+void drawCurves(void)
+{
+    for (size_t i = 0; i<curves.size(); i++)
+    {
+        const Curve &c = curves[i];
+        if(c.rx == c.ry)
+        {
+            if(fill_curves) circle_spans(c.xc, c.yc, c.rx, setSpan);
+            else circle_points(c.xc, c.yc, c.rx, setPixel);
+        }
+        else
+        {
+            if(fill_curves) ellipse_spans(c.xc, c.yc, c.rx, c.ry, setSpan);
+            else ellipse_points(c.xc, c.yc, c.rx, c.ry, setPixel);
+        }
+    }
+}
 
-    double m = (y2-y1)/(x2-x1);
+/**
+ * readInput() - reads the segment to draw and rounds it to pixels.
+ */
+void readInput(void)
+{
+    if(input_path != NULL)
+    {
+        if(!open_segments(input, input_path)) exit(EXIT_FAILURE);
+        printf("%lu segments from %s\n", (unsigned long)input.count, input_path);
+        return;
+    }
 
-    if(!(0<=m && m<=1))
+    if(stroking)
     {
-        printf("m should be in range of 0 to 1.\n");
-        printf("To get the mirrored counter part, swap the co-ordinates accordingly.\n");
-        exit(0);
+        int n;
+        printf("How many vertices?: ");
+        scanf("%d", &n);
+        printf("Give %d vertices as input in format \"x y\":\n", n);
+        for (int i = 0; i<n; i++)
+        {
+            Vertex v;
+            scanf("%d %d", &v.x, &v.y);
+            polyline.push_back(v);
+        }
         return;
     }
 
+    double x1, y1, x2, y2;
+
+    printf("Give the input as: \"x1 y1 x2 y2\" - ");
+    scanf("%lf %lf %lf %lf", &x1, &y1, &x2, &y2);
+
+    /// rounded like the segment files, so both draw the same pixels
+    double v[4] = {x1, y1, x2, y2};
+    Segment seg;
+    if(!round_segment(v, seg))
+    {
+        printf("The co-ordinates must fit in an int\n");
+        exit(EXIT_FAILURE);
+    }
+    segments.push_back(seg);
+}
+
+/**
+ * static_layer - content which is the same in every frame. It is drawn
+ *                once by its draw function and from then on only
+ *                composited: copied as a whole into the framebuffer, or
+ *                replayed from a display list in OpenGL. A static layer is
+ *                the bottom of the frame, so compositing it also clears.
+ */
+struct static_layer
+{
+    void (*draw)(void);
+    bool cached;
+    framebuffer image;
+    block_framebuffer blocked_image;
+    GLuint list;
+};
+
+/**
+ * compositeLayer(static_layer&) - starts a frame with the layer, drawing
+ *                                 it only the first time.
+ */
+void compositeLayer(static_layer &layer)
+{
+    if(software_backend)
+    {
+        if(layer.cached)
+        {
+            if(blocked_layout) bf_blit(blocks, layer.blocked_image);
+            else fb_blit(screen, layer.image);
+            return;
+        }
 
-    int x = x1prime, y = y1prime;
-    int dx = x2prime - x1prime, dy = y2prime - y1prime, dT = 2*(dy-dx), dS = 2*dy;
-    int d = 2*dy - dx;
-    setPixel(x,y);
+        clearScreen();
+        layer.draw();
+        if(blocked_layout) layer.blocked_image = blocks;
+        else layer.image = screen;
+        layer.cached = true;
+        return;
+    }
 
-    while(x<x2prime)
+    clearScreen();
+    if(layer.cached)
     {
-        x++;
-        if(d<0) d+=dS;
-        else y++,d+=dT;
-        setPixel(x,y);
+        /**
+         * glCallList(GLuint list) - executes the commands recorded in
+         *                           the display list.
+         */
+        glCallList(layer.list);
+        draw_calls++;
+        return;
     }
 
     /**
-     * glutSwapBuffers() -  swaps the buffers of the current window
-     *                      if double buffered
+     * glNewList(GLuint list, GLenum mode) - starts recording GL commands
+     *                          into a display list. GL_COMPILE_AND_EXECUTE
+     *                          also runs them while recording. The points
+     *                          of the layer are flushed inside the list, so
+     *                          replaying it is one draw call too.
      */
-    glutSwapBuffers();
+    layer.draw();
+    layer.list = glGenLists(1);
+    glNewList(layer.list, GL_COMPILE_AND_EXECUTE);
+    flushPoints();
+    glEndList();
+    layer.cached = true;
+}
+
+/**
+ * drawAxes() - the two co-ordinate axes.
+ */
+void drawAxes(void)
+{
+    /**
+     * void glColor3f(GLfloat red, GLfloat green, GLfloat blue) -
+     *          set RGB color.
+     */
+    setColor(1,0,0); // cyan color
+
+    /// the axes cross at (0,0); write it only once
+    for (int i = -350; i<=350; i++)
+    {
+        setPixel(i,0);
+        if(i != 0) setPixel(0,i);
+    }
+}
+
+static_layer axes_layer = {drawAxes, false};
+
+void bresenham_algo(void)
+{
+    compositeLayer(axes_layer);
+
+    setColor(0,1,1); // cyan color
+
+    ///Main algorithm
+
+    if(stroking) stroke_polyline(&polyline[0], polyline.size(), stroke, -350, 349, setSpan);
+    else if(input_path != NULL) drawLines(input.segments, input.count);
+    else drawLines(&segments[0], segments.size());
+    drawCurves();
+
+    presentFrame();
 }
 
 
 int main(int argc, char *argv[])
 {
+    /**
+     * Command line options:
+     *  -software          draw into the in-memory framebuffer and flush it
+     *                     to the window once per frame
+     *  -headless out.ppm  no window at all; draw one frame into the
+     *                     framebuffer and write it to out.ppm
+     *  -kernel name       line kernel of the framebuffer: bresenham,
+     *                     double, runslice or dda; "auto" times the exact
+     *                     ones first and takes the fastest
+     *  -threads N         rasterize the framebuffer in tiles on N threads;
+     *                     below 3 threads or 256 segments the kernel draws
+     *                     them serially, which is faster
+     *  -antialias         anti-aliased (Wu) lines; implies -software.
+     *                     They are blended on one thread into the linear
+     *                     layout, so -threads and -layout are dropped.
+     *                     Not allowed with -overdraw, -blend or -dedup
+     *  -layout blocked    keep the framebuffer in 8 x 8 blocks while
+     *                     drawing (faster steep lines); implies -software
+     *                     and takes over from -kernel and -threads
+     *  -circle x y r      also draw a circle (midpoint algorithm)
+     *  -ellipse x y a b   also draw an ellipse with radii a and b
+     *  -fill              fill the circles and ellipses
+     *  -stroke w join     read a polyline instead of a segment and draw it
+     *                     w pixels wide; join is miter or round
+     *  -input file        draw the segments of a file instead: the binary
+     *                     format of segfile.h or text "x1 y1 x2 y2" lines
+     *  -overdraw          count the writes of every pixel and report the
+     *                     overdraw after each frame
+     *  -blend a           blend the colors in with opacity a (0..1)
+     *  -dedup             write each pixel only once per color, through a
+     *                     coverage bitmask; with -blend, overlaps are no
+     *                     darker than the lines
+     *  -stats            print the GL draw calls of every frame
+     *  -overdraw, -blend and -dedup send every pixel through setPixel, so
+     *  the line kernels, -threads and, with -blend, -layout are not used.
+     */
+    for (int i = 1; i<argc; i++)
+    {
+        if(strcmp(argv[i], "-software") == 0) software_backend = true;
+        else if(strcmp(argv[i], "-kernel") == 0 && i+1<argc)
+        {
+            i++;
+            if(strcmp(argv[i], "auto") == 0)
+            {
+                int best = fastest_line_kernel();
+                kernel = line_kernels[best].draw;
+                printf("Fastest line kernel: %s\n", line_kernels[best].name);
+            }
+            else if(find_line_kernel(argv[i]) != NULL) kernel = find_line_kernel(argv[i]);
+            else printf("Unknown line kernel %s, using bresenham\n", argv[i]);
+        }
+        else if(strcmp(argv[i], "-antialias") == 0) software_backend = true, kernel = drawLinesAA;
+        else if(strcmp(argv[i], "-threads") == 0 && i+1<argc) pool = new work_stealing_pool(atoi(argv[++i]));
+        else if(strcmp(argv[i], "-headless") == 0 && i+1<argc) headless_output = argv[++i];
+        else if(strcmp(argv[i], "-circle") == 0 && i+3<argc)
+        {
+            Curve c = {atoi(argv[i+1]), atoi(argv[i+2]), atoi(argv[i+3]), atoi(argv[i+3])};
+            curves.push_back(c);
+            i += 3;
+        }
+        else if(strcmp(argv[i], "-ellipse") == 0 && i+4<argc)
+        {
+            Curve c = {atoi(argv[i+1]), atoi(argv[i+2]), atoi(argv[i+3]), atoi(argv[i+4])};
+            curves.push_back(c);
+            i += 4;
+        }
+        else if(strcmp(argv[i], "-fill") == 0) fill_curves = true;
+        else if(strcmp(argv[i], "-input") == 0 && i+1<argc) input_path = argv[++i];
+        else if(strcmp(argv[i], "-stroke") == 0 && i+2<argc)
+        {
+            stroking = true;
+            stroke.width = atoi(argv[i+1]);
+            stroke.round = strcmp(argv[i+2], "round") == 0;
+            i += 2;
+        }
+        else if(strcmp(argv[i], "-layout") == 0 && i+1<argc)
+        {
+            i++;
+            if(strcmp(argv[i], "blocked") == 0) software_backend = blocked_layout = true;
+            else if(strcmp(argv[i], "linear") != 0) printf("Unknown layout %s, using linear\n", argv[i]);
+        }
+        else if(strcmp(argv[i], "-overdraw") == 0) count_writes = true;
+        else if(strcmp(argv[i], "-blend") == 0 && i+1<argc)
+        {
+            blending = true;
+            blend_alpha = min(1.0, max(0.0, atof(argv[++i])))*256 + 0.5;
+        }
+        else if(strcmp(argv[i], "-dedup") == 0) dedup_writes = true;
+        else if(strcmp(argv[i], "-stats") == 0) print_stats = true;
+    }
+
+    /// the block layout has no blending; the pixels go row-major instead
+    if(blending) blocked_layout = false;
+    if(kernel == drawLinesAA && (count_writes || blending || dedup_writes))
+    {
+        printf("-antialias cannot be combined with -overdraw, -blend or -dedup: they draw through setPixel, which is not anti-aliased\n");
+        return EXIT_FAILURE;
+    }
+    if(kernel == drawLinesAA && (blocked_layout || pool != NULL))
+    {
+        printf("-antialias draws on one thread into the linear layout; -threads and -layout are not used\n");
+        blocked_layout = false;
+        delete pool;
+        pool = NULL;
+    }
+    if(count_writes) od_init(overdraw, -350, -350, 700, 700);
+    if(dedup_writes) cm_init(covered, -350, -350, 700, 700);
+
+    if(headless_output != NULL)
+    {
+        software_backend = true;
+        fb_init(screen, -350, -350, 700, 700);
+        if(blocked_layout) bf_init(blocks, -350, -350, 700, 700);
+
+        readInput();
+        double start = fb_clock_ms();
+        bresenham_algo();
+        printf("Frame time: %.3f ms\n", fb_clock_ms() - start);
+
+        if(!fb_write_ppm(screen, headless_output))
+        {
+            printf("Could not write %s\n", headless_output);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if(software_backend) fb_init(screen, -350, -350, 700, 700);
+    if(blocked_layout) bf_init(blocks, -350, -350, 700, 700);
+
     /**
      * glutInit(int, char*) - initializes glut environment.
      */
@@ -147,10 +609,17 @@ int main(int argc, char *argv[])
      *                              define a 2D orthographic projection matrix
      */
     gluOrtho2D(-350,350,-350,350);
-    printf("Give the input as: \"x1 y1 x2 y2\" - ");
 
-    scanf("%lf %lf %lf %lf", &x1, &y1, &x2, &y2);
-    if(x1>x2) swap(x1,x2), swap(y1,y2);
+    /**
+     * glBlendFunc(GLenum sfactor, GLenum dfactor) - with GL_BLEND on, the
+     *                          point color is mixed in by its alpha.
+     */
+    if(blending && !software_backend)
+    {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+    readInput();
 
     /**
      * void glutDisplayFunc(void (*func)(void))  - this function takes a function pointer
@@ -169,3 +638,17 @@ int main(int argc, char *argv[])
 
     return EXIT_SUCCESS;
 }
+
+/**
+-300 -340 20 345
+
+-200 100 300 -150
+
+0 0 349 0
+
+-2000000000 -2000000000 2000000000 2000000000
+
+-2147483647 -1000000007 2147483647 1000000013
+
+1000000007 -2147483647 -1000000009 2147483647
+*/
@@ -0,0 +1,151 @@
+#ifndef OVERDRAW_H_INCLUDED
+#define OVERDRAW_H_INCLUDED
+
+/**
+ * Overdraw statistics and write deduplication
+ *
+ * Where segments cross or run on top of each other, the same pixel is
+ * written again and again. With opaque colors only the last write is
+ * seen and the others are wasted work; with blending every write mixes
+ * the color in once more, so a crossing gets darker than the lines.
+ *
+ * overdraw_counter counts the writes of every pixel of the surface and
+ * sums them up into an overdraw report. coverage_mask keeps one bit per
+ * pixel: the first write of a pass sets it and every further write of
+ * the same pass is skipped, so each pixel is blended exactly once.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+/**
+ * overdraw_counter - writes per pixel of a surface laid out like
+ *                    framebuffer; clipped counts the writes which fell
+ *                    outside the surface.
+ */
+struct overdraw_counter
+{
+    int left, bottom;
+    int width, height;
+    vector<unsigned int> writes;
+    unsigned long long clipped;
+};
+
+inline void od_init(overdraw_counter &od, int left, int bottom, int width, int height)
+{
+    od.left = left;
+    od.bottom = bottom;
+    od.width = width;
+    od.height = height;
+    od.writes.assign((size_t)width*height, 0);
+    od.clipped = 0;
+}
+
+inline void od_clear(overdraw_counter &od)
+{
+    fill(od.writes.begin(), od.writes.end(), 0);
+    od.clipped = 0;
+}
+
+/**
+ * od_count(overdraw_counter&,int,int) - one write of pixel (x,y).
+ */
+inline void od_count(overdraw_counter &od, int x, int y)
+{
+    unsigned int col = x - od.left, row = y - od.bottom;
+    if(col >= (unsigned int)od.width || row >= (unsigned int)od.height) od.clipped++;
+    else od.writes[(size_t)row*od.width + col]++;
+}
+
+/**
+ * od_report(const overdraw_counter&,FILE*) - prints how many writes went
+ *                      to how many distinct pixels, the share of redundant
+ *                      writes and how deep the overdraw goes.
+ */
+inline void od_report(const overdraw_counter &od, FILE *out)
+{
+    /// pixels by number of writes: 1, 2, 3-4, 5-8, 9-16, more
+    unsigned long long total = 0, touched = 0, depth[6] = {0};
+    unsigned int deepest = 0;
+    for (size_t i = 0; i<od.writes.size(); i++)
+    {
+        unsigned int w = od.writes[i];
+        if(w == 0) continue;
+        total += w;
+        touched++;
+        deepest = max(deepest, w);
+
+        int bucket = 0;
+        while(bucket < 5 && w > (1u << bucket)) bucket++;
+        depth[bucket]++;
+    }
+
+    if(touched == 0)
+    {
+        fprintf(out, "Overdraw: no pixel written, %llu writes clipped\n", od.clipped);
+        return;
+    }
+
+    fprintf(out, "Overdraw: %llu writes to %llu pixels, %.3f writes per pixel\n", total, touched, (double)total/touched);
+    fprintf(out, "          %llu redundant writes (%.1f%%), %llu clipped, deepest pixel written %u times\n",
+            total-touched, 100.0*(total-touched)/total, od.clipped, deepest);
+    fprintf(out, "          pixels written 1: %llu  2: %llu  3-4: %llu  5-8: %llu  9-16: %llu  17+: %llu\n",
+            depth[0], depth[1], depth[2], depth[3], depth[4], depth[5]);
+}
+
+/**
+ * coverage_mask - one bit per pixel of a surface, set once the pixel was
+ *                 written in the current pass.
+ */
+struct coverage_mask
+{
+    int left, bottom;
+    int width, height;
+    vector<uint64_t> bits;
+    unsigned long long skipped;
+};
+
+inline void cm_init(coverage_mask &cm, int left, int bottom, int width, int height)
+{
+    cm.left = left;
+    cm.bottom = bottom;
+    cm.width = width;
+    cm.height = height;
+    cm.bits.assign(((size_t)width*height + 63) / 64, 0);
+    cm.skipped = 0;
+}
+
+/**
+ * cm_clear(coverage_mask&) - starts a new pass; 700 x 700 pixels are
+ *                            only 61 KB of bits, so this is one memset.
+ */
+inline void cm_clear(coverage_mask &cm)
+{
+    if(!cm.bits.empty()) memset(&cm.bits[0], 0, cm.bits.size()*sizeof(uint64_t));
+}
+
+/**
+ * cm_first(coverage_mask&,int,int) - true for the first write of pixel
+ *                      (x,y) in this pass, and marks it written. Later
+ *                      writes and pixels outside the surface give false.
+ */
+inline bool cm_first(coverage_mask &cm, int x, int y)
+{
+    unsigned int col = x - cm.left, row = y - cm.bottom;
+    if(col >= (unsigned int)cm.width || row >= (unsigned int)cm.height) return false;
+
+    size_t i = (size_t)row*cm.width + col;
+    uint64_t bit = (uint64_t)1 << (i & 63);
+    if(cm.bits[i >> 6] & bit)
+    {
+        cm.skipped++;
+        return false;
+    }
+    cm.bits[i >> 6] |= bit;
+    return true;
+}
+
+#endif // OVERDRAW_H_INCLUDED
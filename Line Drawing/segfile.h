@@ -0,0 +1,285 @@
+#ifndef SEGFILE_H_INCLUDED
+#define SEGFILE_H_INCLUDED
+
+/**
+ * Segment files
+ *
+ * Binary format, little endian:
+ *
+ *      offset 0   "SEGS"                   magic
+ *      offset 4   uint32 type              0 = int32, 1 = float32 endpoints
+ *      offset 8   uint64 count             number of segments
+ *      offset 16  count * {x1, y1, x2, y2} packed endpoints
+ *
+ * The file is memory mapped (mmap, or CreateFileMapping on Windows). With
+ * int32 endpoints the records already have the layout of Segment, so the
+ * rasterizer reads them straight from the mapping: nothing is copied and
+ * only the pages that are touched are ever read from disk. Float records
+ * are rounded to pixels once, into a vector. A file with an endpoint off
+ * the int range is rejected.
+ *
+ * Any other file is taken as text, "x1 y1 x2 y2" per segment like the
+ * interactive input, parsed in place from the mapping with from_chars.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(__has_include)
+#if __has_include(<charconv>) && __cplusplus >= 201703L
+#include <charconv>
+#endif
+#endif
+#include "line.h"
+
+const char SEGMENT_MAGIC[4] = {'S','E','G','S'};
+const uint32_t SEGMENT_INT32 = 0, SEGMENT_FLOAT32 = 1;
+const size_t SEGMENT_HEADER = 16;
+
+/**
+ * segment_file - the segments of an opened file. segments points into the
+ *                mapping (int32 files) or into converted (float and text
+ *                files); it stays valid until close_segments.
+ */
+struct segment_file
+{
+    const Segment *segments;
+    size_t count;
+    vector<Segment> converted;
+
+    const char *data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+};
+
+/**
+ * parse_number(const char*&,const char*,double&) - reads the next number of
+ *                      the text, skipping white space. Returns false at the
+ *                      end of the text or on anything that is no number.
+ */
+inline bool parse_number(const char *&p, const char *end, double &value)
+{
+    while(p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    if(p == end) return false;
+
+#if defined(__cpp_lib_to_chars)
+    if(*p == '+') p++;
+
+    /// most files hold whole pixels; integers parse much faster
+    long long whole;
+    std::from_chars_result r = std::from_chars(p, end, whole);
+    if(r.ec == std::errc() && (r.ptr == end || (*r.ptr != '.' && *r.ptr != 'e' && *r.ptr != 'E')))
+    {
+        value = whole;
+        p = r.ptr;
+        return true;
+    }
+
+    r = std::from_chars(p, end, value);
+    if(r.ec != std::errc()) return false;
+    p = r.ptr;
+    return true;
+#else
+    /// strtod needs a terminated string; numbers are short, so copy one
+    char buffer[64];
+    size_t n = 0;
+    while(p+n < end && n+1 < sizeof(buffer) && !isspace((unsigned char)p[n])) n++;
+    memcpy(buffer, p, n);
+    buffer[n] = 0;
+
+    char *stop;
+    value = strtod(buffer, &stop);
+    if(stop == buffer) return false;
+    p += stop - buffer;
+    return true;
+#endif
+}
+
+/**
+ * parse_segments(const char*,const char*,vector<Segment>&) - the text path:
+ *                      every four numbers make one segment. Returns false
+ *                      at a segment off the int range; segs holds the ones
+ *                      before it.
+ */
+inline bool parse_segments(const char *p, const char *end, vector<Segment> &segs)
+{
+    double v[4];
+    segs.clear();
+    /// a guess: most lines of real files are 12 to 20 characters long
+    segs.reserve((end-p) / 16);
+    while(true)
+    {
+        for (int i = 0; i<4; i++)
+            if(!parse_number(p, end, v[i])) return true;
+
+        Segment s;
+        if(!round_segment(v, s)) return false;
+        segs.push_back(s);
+    }
+}
+
+/**
+ * close_segments(segment_file&) - unmaps the file.
+ */
+inline void close_segments(segment_file &f)
+{
+#ifdef _WIN32
+    if(f.data != NULL) UnmapViewOfFile(f.data);
+    if(f.mapping != NULL) CloseHandle(f.mapping);
+    if(f.file != INVALID_HANDLE_VALUE) CloseHandle(f.file);
+    f.file = INVALID_HANDLE_VALUE;
+    f.mapping = NULL;
+#else
+    if(f.data != NULL) munmap((void*)f.data, f.size);
+#endif
+    f.data = NULL;
+    f.size = 0;
+    f.segments = NULL;
+    f.count = 0;
+    f.converted.clear();
+}
+
+/**
+ * map_file(segment_file&,const char*) - maps the whole file read-only.
+ */
+inline bool map_file(segment_file &f, const char *path)
+{
+    f.data = NULL;
+    f.size = 0;
+#ifdef _WIN32
+    f.mapping = NULL;
+    f.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(f.file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(f.file, &size)) return false;
+    f.size = size.QuadPart;
+    if(f.size == 0) return true;
+
+    f.mapping = CreateFileMappingA(f.file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(f.mapping == NULL) return false;
+    f.data = (const char*)MapViewOfFile(f.mapping, FILE_MAP_READ, 0, 0, 0);
+    return f.data != NULL;
+#else
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    f.size = st.st_size;
+    if(f.size == 0)
+    {
+        close(fd);
+        return true;
+    }
+
+    void *data = mmap(NULL, f.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) return false;
+    f.data = (const char*)data;
+    madvise(data, f.size, MADV_SEQUENTIAL);
+    return true;
+#endif
+}
+
+/**
+ * open_segments(segment_file&,const char*) - maps a binary or text segment
+ *                      file. Returns false, with a message, if it cannot be
+ *                      read, the binary header does not fit the size or a
+ *                      segment is off the int range.
+ */
+inline bool open_segments(segment_file &f, const char *path)
+{
+    f.segments = NULL;
+    f.count = 0;
+    if(!map_file(f, path))
+    {
+        printf("Could not map %s\n", path);
+        close_segments(f);
+        return false;
+    }
+
+    if(f.size >= SEGMENT_HEADER && memcmp(f.data, SEGMENT_MAGIC, 4) == 0)
+    {
+        uint32_t type;
+        uint64_t count;
+        memcpy(&type, f.data+4, 4);
+        memcpy(&count, f.data+8, 8);
+
+        if(type > SEGMENT_FLOAT32 || count > (f.size - SEGMENT_HEADER) / 16)
+        {
+            printf("%s: broken segment file header\n", path);
+            close_segments(f);
+            return false;
+        }
+
+        f.count = count;
+        if(type == SEGMENT_INT32)
+        {
+            /// the mapping is page aligned, so the records are aligned too
+            f.segments = (const Segment*)(f.data + SEGMENT_HEADER);
+            return true;
+        }
+
+        f.converted.resize(count);
+        const float *v = (const float*)(f.data + SEGMENT_HEADER);
+        for (size_t i = 0; i<count; i++, v+=4)
+        {
+            double ends[4] = {v[0], v[1], v[2], v[3]};
+            if(!round_segment(ends, f.converted[i]))
+            {
+                printf("%s: segment %lu is off the int range\n", path, (unsigned long)i+1);
+                close_segments(f);
+                return false;
+            }
+        }
+    }
+    else if(f.size > 0 && !parse_segments(f.data, f.data + f.size, f.converted))
+    {
+        printf("%s: segment %lu is off the int range\n", path, (unsigned long)f.converted.size()+1);
+        close_segments(f);
+        return false;
+    }
+
+    f.count = f.converted.size();
+    f.segments = f.count ? &f.converted[0] : NULL;
+    return true;
+}
+
+/**
+ * write_segments(const char*,const Segment*,size_t) - writes an int32
+ *                      binary segment file. Returns false on failure.
+ */
+inline bool write_segments(const char *path, const Segment *segs, size_t n)
+{
+    FILE *fp = fopen(path, "wb");
+    if(fp == NULL) return false;
+
+    uint32_t type = SEGMENT_INT32;
+    uint64_t count = n;
+    fwrite(SEGMENT_MAGIC, 1, 4, fp);
+    fwrite(&type, 4, 1, fp);
+    fwrite(&count, 8, 1, fp);
+    if(n) fwrite(segs, sizeof(Segment), n, fp);
+
+    return fclose(fp) == 0;
+}
+
+#endif // SEGFILE_H_INCLUDED
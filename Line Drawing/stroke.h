@@ -0,0 +1,272 @@
+#ifndef STROKE_H_INCLUDED
+#define STROKE_H_INCLUDED
+
+/**
+ * Thick polylines
+ *
+ * A stroke of width w is the union of simple convex pieces: a w wide
+ * rectangle along every segment and, at every inner vertex, the join that
+ * closes the gap on the outer side of the turn (a disc for round joins, a
+ * miter or bevel wedge otherwise). Round strokes get discs as caps too.
+ *
+ * The pieces overlap, so drawing them one after another would write the
+ * overlap several times. Instead the whole polyline is scan converted at
+ * once: pieces are bucketed by their first row, and on every row the x
+ * intervals of the active pieces are sorted and merged. Each row of the
+ * stroke then leaves as a few disjoint spans and every pixel is written
+ * exactly once. A pixel belongs to the stroke when its centre (integer
+ * co-ordinates) is inside one of the pieces.
+ */
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "../Shared/framebuffer.h"
+#include "circle.h"
+
+/**
+ * Vertex - one corner of a polyline in integer pixel co-ordinates.
+ */
+struct Vertex
+{
+    int x, y;
+};
+
+/**
+ * stroke_style - width in pixels and the kind of joins. Miter joins turn
+ *                into bevels where the miter would be longer than
+ *                miter_limit times the half width, and have flat ends;
+ *                round strokes have round joins and round ends.
+ */
+struct stroke_style
+{
+    int width;
+    bool round;
+    double miter_limit;
+};
+
+/**
+ * stroke_piece - a convex polygon of up to 4 corners, or a disc (n == 0),
+ *                covering the rows first..last.
+ */
+struct stroke_piece
+{
+    int n;
+    double x[4], y[4];
+    double cx, cy, r;
+    int first, last;
+};
+
+inline bool piece_before(const stroke_piece &a, const stroke_piece &b)
+{
+    return a.first < b.first;
+}
+
+inline void add_polygon(vector<stroke_piece> &pieces, int n, const double *x, const double *y)
+{
+    stroke_piece p;
+    p.n = n;
+    double lo = y[0], hi = y[0];
+    for (int i = 0; i<n; i++)
+    {
+        p.x[i] = x[i], p.y[i] = y[i];
+        lo = min(lo, y[i]), hi = max(hi, y[i]);
+    }
+    p.first = ceil(lo);
+    p.last = floor(hi);
+    if(p.first <= p.last) pieces.push_back(p);
+}
+
+inline void add_disc(vector<stroke_piece> &pieces, double cx, double cy, double r)
+{
+    stroke_piece p;
+    p.n = 0;
+    p.cx = cx, p.cy = cy, p.r = r;
+    p.first = ceil(cy - r);
+    p.last = floor(cy + r);
+    if(p.first <= p.last) pieces.push_back(p);
+}
+
+/**
+ * piece_row(const stroke_piece&,int,int&,int&) - the pixels xl..xr of row
+ *                      y whose centres are inside the piece. Returns false
+ *                      if there is none.
+ */
+inline bool piece_row(const stroke_piece &p, int y, int &xl, int &xr)
+{
+    double lo, hi;
+    if(p.n == 0)
+    {
+        double h = p.r*p.r - (y-p.cy)*(y-p.cy);
+        if(h < 0) return false;
+        lo = p.cx - sqrt(h), hi = p.cx + sqrt(h);
+    }
+    else
+    {
+        lo = 1e300, hi = -1e300;
+        for (int i = 0; i<p.n; i++)
+        {
+            int j = (i+1) % p.n;
+            double y1 = p.y[i], y2 = p.y[j];
+            if(y < min(y1, y2) || y > max(y1, y2)) continue;
+
+            if(y1 == y2) lo = min(lo, min(p.x[i], p.x[j])), hi = max(hi, max(p.x[i], p.x[j]));
+            else
+            {
+                double x = p.x[i] + (y-y1)*(p.x[j]-p.x[i])/(y2-y1);
+                lo = min(lo, x), hi = max(hi, x);
+            }
+        }
+    }
+
+    xl = ceil(lo);
+    xr = floor(hi);
+    return xl <= xr;
+}
+
+/**
+ * stroke_pieces(const Vertex*,size_t,const stroke_style&,vector<stroke_piece>&)
+ *                    - cuts the stroke of the polyline into convex pieces.
+ */
+inline void stroke_pieces(const Vertex *points, size_t n, const stroke_style &style, vector<stroke_piece> &pieces)
+{
+    double hw = style.width / 2.0;
+    pieces.clear();
+    if(n == 0 || style.width <= 0) return;
+
+    /// unit directions of the segments; zero length ones are skipped
+    vector<size_t> corner;
+    corner.push_back(0);
+    for (size_t i = 1; i<n; i++)
+        if(points[i].x != points[corner.back()].x || points[i].y != points[corner.back()].y)
+            corner.push_back(i);
+
+    if(corner.size() == 1)
+    {
+        if(style.round) add_disc(pieces, points[0].x, points[0].y, hw);
+        return;
+    }
+
+    for (size_t k = 0; k+1<corner.size(); k++)
+    {
+        const Vertex &a = points[corner[k]], &b = points[corner[k+1]];
+        double len = hypot(b.x-a.x, b.y-a.y);
+        double nx = -(b.y-a.y)/len*hw, ny = (b.x-a.x)/len*hw;
+
+        double x[4] = {a.x+nx, b.x+nx, b.x-nx, a.x-nx};
+        double y[4] = {a.y+ny, b.y+ny, b.y-ny, a.y-ny};
+        add_polygon(pieces, 4, x, y);
+    }
+
+    for (size_t k = 1; k+1<corner.size(); k++)
+    {
+        const Vertex &a = points[corner[k-1]], &v = points[corner[k]], &b = points[corner[k+1]];
+        if(style.round)
+        {
+            add_disc(pieces, v.x, v.y, hw);
+            continue;
+        }
+
+        double ux = v.x-a.x, uy = v.y-a.y, wx = b.x-v.x, wy = b.y-v.y;
+        double lu = hypot(ux, uy), lw = hypot(wx, wy);
+        ux /= lu, uy /= lu, wx /= lw, wy /= lw;
+
+        /// the outer side of the turn is to the right of a left turn
+        double turn = ux*wy - uy*wx;
+        if(turn == 0 && ux*wx + uy*wy > 0) continue;
+        double side = turn > 0 ? -1 : 1;
+
+        double px = v.x - uy*hw*side, py = v.y + ux*hw*side;
+        double qx = v.x - wy*hw*side, qy = v.y + wx*hw*side;
+
+        /// the miter tip is on the bisector, hw / cos(half the turn) away
+        double mx = px - qx, my = py - qy;
+        double cos_half = sqrt(max(0.0, (1 + ux*wx + uy*wy) / 2));
+        if(cos_half > 1/style.miter_limit)
+        {
+            double bx = (-uy - wy)*side, by = (ux + wx)*side;
+            double bl = hypot(bx, by), tip = hw / cos_half;
+            double x[4] = {(double)v.x, px, v.x + bx/bl*tip, qx};
+            double y[4] = {(double)v.y, py, v.y + by/bl*tip, qy};
+            add_polygon(pieces, 4, x, y);
+        }
+        else if(mx != 0 || my != 0)
+        {
+            double x[3] = {(double)v.x, px, qx};
+            double y[3] = {(double)v.y, py, qy};
+            add_polygon(pieces, 3, x, y);
+        }
+    }
+
+    if(style.round)
+    {
+        add_disc(pieces, points[corner.front()].x, points[corner.front()].y, hw);
+        add_disc(pieces, points[corner.back()].x, points[corner.back()].y, hw);
+    }
+}
+
+/**
+ * stroke_polyline(const Vertex*,size_t,const stroke_style&,int,int,Span&) -
+ *                      calls span(y,xl,xr) for the stroke of the polyline on
+ *                      rows Y0..Y1. The spans of a row are disjoint, so no
+ *                      pixel is emitted twice.
+ */
+template <class Span>
+inline void stroke_polyline(const Vertex *points, size_t n, const stroke_style &style, int Y0, int Y1, Span &span)
+{
+    vector<stroke_piece> pieces;
+    stroke_pieces(points, n, style, pieces);
+    if(pieces.empty()) return;
+
+    /// bucket by first row, then sweep with an active list
+    stable_sort(pieces.begin(), pieces.end(), piece_before);
+
+    vector<const stroke_piece*> active;
+    vector< pair<int,int> > runs;
+    size_t next = 0;
+    int y = max(Y0, pieces[0].first);
+
+    while(y <= Y1 && (next < pieces.size() || !active.empty()))
+    {
+        while(next < pieces.size() && pieces[next].first <= y)
+        {
+            if(pieces[next].last >= y) active.push_back(&pieces[next]);
+            next++;
+        }
+
+        runs.clear();
+        size_t kept = 0;
+        for (size_t i = 0; i<active.size(); i++)
+        {
+            if(active[i]->last < y) continue;
+            active[kept++] = active[i];
+
+            int xl, xr;
+            if(piece_row(*active[i], y, xl, xr)) runs.push_back(make_pair(xl, xr));
+        }
+        active.resize(kept);
+
+        sort(runs.begin(), runs.end());
+        for (size_t i = 0; i<runs.size(); )
+        {
+            int xl = runs[i].first, xr = runs[i].second;
+            for (i++; i<runs.size() && runs[i].first <= xr+1; i++)
+                xr = max(xr, runs[i].second);
+            span(y, xl, xr);
+        }
+
+        y++;
+        if(active.empty() && next < pieces.size()) y = max(y, pieces[next].first);
+    }
+}
+
+/**
+ * fb_polyline(framebuffer&,const Vertex*,size_t,const stroke_style&) -
+ *                      the stroke in the current color, one fb_span per run.
+ */
+inline void fb_polyline(framebuffer &fb, const Vertex *points, size_t n, const stroke_style &style)
+{
+    fb_span_sink span(fb);
+    stroke_polyline(points, n, style, fb.bottom, fb.bottom+fb.height-1, span);
+}
+
+#endif // STROKE_H_INCLUDED
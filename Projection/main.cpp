@@ -7,8 +7,17 @@
  * in respect to the XY Plane.
  */
 #include "headers.h"
+#include "../Shared/framebuffer.h"
 
-double x0,y0,z0,a,b,c,d,d0,d1,n1,n2,n3;
+/**
+ * Headless mode (-headless out.ppm): no window is opened. Everything is
+ * drawn into the software framebuffer "screen" and the one frame is
+ * written to out.ppm, so the program also runs without a display.
+ */
+const char *headless_output = NULL;
+framebuffer screen;
+
+double rx,ry,rz,a,b,c,d,d0,d1,n1,n2,n3;
 
 struct matrix
 {
@@ -27,11 +36,44 @@ void nullify(int n, int m, matrix &mat)
             mat.mat[i][j] = 0;
 }
 
+/**
+ * SetColor(float,float,float) - glColor3f, or the drawing color of the
+ *                               framebuffer in headless mode.
+ */
+void SetColor(float r, float g, float b)
+{
+    if(headless_output != NULL) fb_color(screen, r, g, b);
+    else glColor3f(r, g, b);
+}
+
+/**
+ * ClearScreen() - glClear, or clearing the framebuffer in headless mode.
+ */
+void ClearScreen()
+{
+    if(headless_output != NULL) fb_clear(screen);
+    else glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+/**
+ * ShowFrame() - glutSwapBuffers; nothing to show in headless mode.
+ */
+void ShowFrame()
+{
+    if(headless_output == NULL) glutSwapBuffers();
+}
+
 /**
  * This function draws a line from (x1, y1) to (x2,y2) pixel co-ordinate.
  */
 void DrawLine(double x1, double  y1, double x2, double y2)
 {
+    if(headless_output != NULL)
+    {
+        fb_line(screen, x1, y1, x2, y2);
+        return;
+    }
+
 //    cout<<x1<<" "<<y1<<" "<<z1 << " KK"<<endl;
 //    cout<<x2<<" "<<y2<<" "<<z2 << " OK"<<endl;
     /**
@@ -104,9 +146,9 @@ matrix matmult(matrix &a, matrix &b)
 
 void projection(void)
 {
-    glClear(GL_COLOR_BUFFER_BIT);
-    glutSwapBuffers();
-    glColor3f(1,0,0); // cyan color
+    ClearScreen();
+    ShowFrame();
+    SetColor(1,0,0); // cyan color
     DrawLine(result.mat[0][0],result.mat[1][0],result.mat[0][1],result.mat[1][1]);
     DrawLine(result.mat[0][0],result.mat[1][0],result.mat[0][5],result.mat[1][5]);
     DrawLine(result.mat[0][0],result.mat[1][0],result.mat[0][3],result.mat[1][3]);
@@ -119,7 +161,7 @@ void projection(void)
     DrawLine(result.mat[0][6],result.mat[1][6],result.mat[0][7],result.mat[1][7]);
     DrawLine(result.mat[0][4],result.mat[1][4],result.mat[0][7],result.mat[1][7]);
     DrawLine(result.mat[0][2],result.mat[1][2],result.mat[0][7],result.mat[1][7]);
-    glutSwapBuffers();
+    ShowFrame();
 
 }
 
@@ -127,60 +169,67 @@ int main(int argc, char *argv[])
 {
     int x1, y1, x2, y2, z1, z2;
 
-    /**
-     * glutInit(int, char*) - initializes glut environment.
-     */
-    glutInit(&argc, argv);
-
-    /**
-     * glutInitWindowSize(int,int)- initializes new glut window of
-     *                              size W * H
-     *                              default: 300, 300
-     */
-    glutInitWindowSize(700,700);
-
-    /**
-     * glutInitWindowPosition(int,int) - set the origin of the
-     *                                   co-ordinate
-     *                                   default: -1, -1
-     */
-    glutInitWindowPosition(10,10);
-
-    /**
-     * glutInitDisplayMode(unsigned int) - set the initial display mode.
-     *                      It can take a combinations of some masks
-     *                      which are not overlapped in their binary
-     *                      representation. So, it takes them having
-     *                      bitwise OR.
-     * GLUT_RGB - the color input would by set by RGB values.
-     * GLUT_DOUBLE - makes it double buffered. It is like using two blackboard.
-     *               One blackboard would be shown to the screen and hidden one
-     *               would be processed behind. they can be swapped any time.
-     * GLUT_DEPTH - It is mainly enables depth concept. Algorithm like z-buffering
-     *              could be done by using this.
-     */
-    glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
-
-    /**
-     * glutCreateWindow(char*) - creates a top-level window having the title
-     *                           given as parameter.
-     */
-    glutCreateWindow("Perspective Projection of a Cube");
+    for (int i = 1; i<argc; i++)
+        if(strcmp(argv[i], "-headless") == 0 && i+1<argc) headless_output = argv[++i];
 
-    /**
-     * gluOrtho2D(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top) -
-     *                              define a 2D orthographic projection matrix
-     */
-    gluOrtho2D(0,700,0,700);
+    if(headless_output == NULL)
+    {
+        /**
+         * glutInit(int, char*) - initializes glut environment.
+         */
+        glutInit(&argc, argv);
+
+        /**
+         * glutInitWindowSize(int,int)- initializes new glut window of
+         *                              size W * H
+         *                              default: 300, 300
+         */
+        glutInitWindowSize(700,700);
+
+        /**
+         * glutInitWindowPosition(int,int) - set the origin of the
+         *                                   co-ordinate
+         *                                   default: -1, -1
+         */
+        glutInitWindowPosition(10,10);
+
+        /**
+         * glutInitDisplayMode(unsigned int) - set the initial display mode.
+         *                      It can take a combinations of some masks
+         *                      which are not overlapped in their binary
+         *                      representation. So, it takes them having
+         *                      bitwise OR.
+         * GLUT_RGB - the color input would by set by RGB values.
+         * GLUT_DOUBLE - makes it double buffered. It is like using two blackboard.
+         *               One blackboard would be shown to the screen and hidden one
+         *               would be processed behind. they can be swapped any time.
+         * GLUT_DEPTH - It is mainly enables depth concept. Algorithm like z-buffering
+         *              could be done by using this.
+         */
+        glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
+
+        /**
+         * glutCreateWindow(char*) - creates a top-level window having the title
+         *                           given as parameter.
+         */
+        glutCreateWindow("Perspective Projection of a Cube");
+
+        /**
+         * gluOrtho2D(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top) -
+         *                              define a 2D orthographic projection matrix
+         */
+        gluOrtho2D(0,700,0,700);
+    }
+    else fb_init(screen, 0, 0, 700, 700);
 
     printf("A view plane can be described by two things. One is Reference point and another is Normal Vector.\n");
     printf("Give the Reference point co-ordinates as input in the format \"x y z\": ");
-    scanf("%lf %lf %lf", &x0, &y0, &z0);
+    scanf("%lf %lf %lf", &rx, &ry, &rz);
 
     printf("Give the co-efficients of the Normal Vector as input in the format \"n1 n2 n3\": ");
     scanf("%lf %lf %lf", &n1, &n2, &n3);
 
-    d0 = x0 * n1 + y0 * n2 + z0 * n3;
+    d0 = rx * n1 + ry * n2 + rz * n3;
 
 
     printf("Give the co-ordinates of Center of projection as input in the format \"x y z\": ");
@@ -221,6 +270,19 @@ int main(int argc, char *argv[])
     }
 
 
+    if(headless_output != NULL)
+    {
+        double start = fb_clock_ms();
+        projection();
+        printf("Frame time: %.3f ms\n", fb_clock_ms() - start);
+        if(!fb_write_ppm(screen, headless_output))
+        {
+            printf("Could not write %s\n", headless_output);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
     /**
      * void glutDisplayFunc(void (*func)(void))  - this function takes a function pointer
      *                                             in which all works done.
@@ -0,0 +1,97 @@
+#ifndef ARENA_H_INCLUDED
+#define ARENA_H_INCLUDED
+
+/**
+ * Per-frame arena
+ *
+ * Scratch memory which lives for one frame: arena_alloc hands out pieces
+ * of one big block by moving a pointer, and arena_reset at the start of
+ * the next frame takes all of them back at once. Nothing is freed one
+ * by one.
+ *
+ * A frame that needs more than the block has gets the rest from extra
+ * blocks on the heap. The next reset frees them and grows the block to
+ * what the frame used in total, so from then on a frame of that size
+ * allocates nothing.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <vector>
+using namespace std;
+
+const size_t ARENA_ALIGN = 16;
+
+struct arena
+{
+    char *base;
+    size_t size, used;
+    vector<char*> spill;    /// extra blocks of this frame
+    size_t spilled;
+};
+
+inline void arena_init(arena &a, size_t size)
+{
+    a.base = size ? (char*)malloc(size) : NULL;
+    a.size = a.base ? size : 0;
+    a.used = 0;
+    a.spilled = 0;
+}
+
+/**
+ * arena_alloc(arena&,size_t) - bytes of scratch memory, aligned to 16,
+ *                              valid until the next arena_reset.
+ */
+inline void *arena_alloc(arena &a, size_t bytes)
+{
+    bytes = (bytes + ARENA_ALIGN-1) & ~(ARENA_ALIGN-1);
+    if(a.used + bytes <= a.size)
+    {
+        void *p = a.base + a.used;
+        a.used += bytes;
+        return p;
+    }
+
+    char *p = (char*)malloc(bytes);
+    if(p == NULL) abort();
+    a.spill.push_back(p);
+    a.spilled += bytes;
+    return p;
+}
+
+/**
+ * arena_array(arena&,size_t) - room for n objects of type T. They are not
+ *                              constructed.
+ */
+template <class T>
+inline T *arena_array(arena &a, size_t n)
+{
+    return (T*)arena_alloc(a, n*sizeof(T));
+}
+
+/**
+ * arena_reset(arena&) - frees everything of the last frame. If the frame
+ *                       spilled over, the block grows to fit all of it.
+ */
+inline void arena_reset(arena &a)
+{
+    if(!a.spill.empty())
+    {
+        for (size_t i = 0; i<a.spill.size(); i++)
+            free(a.spill[i]);
+        a.spill.clear();
+
+        free(a.base);
+        arena_init(a, a.size + a.spilled);
+    }
+    a.used = 0;
+}
+
+inline void arena_free(arena &a)
+{
+    arena_reset(a);
+    free(a.base);
+    a.base = NULL;
+    a.size = 0;
+}
+
+#endif // ARENA_H_INCLUDED
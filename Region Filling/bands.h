@@ -0,0 +1,66 @@
+#ifndef BANDS_H_INCLUDED
+#define BANDS_H_INCLUDED
+
+/**
+ * Parallel band fill
+ *
+ * The scanlines miny..maxy are cut into horizontal bands of equal height
+ * and the bands are filled in parallel on a work-stealing thread pool.
+ * A band does not walk up from miny: it seeds its active list with every
+ * edge crossing its first scanline, jumped there with the exact integer
+ * x and error term (walker_at), and goes on like the serial fill. So each
+ * scanline gets the very same spans as in scanline_fill.
+ *
+ * Every band has its own active list, from the frame arena, and writes
+ * only its own scanlines, so the span sink may be called from several
+ * threads at once as long as different rows don't share memory (true for
+ * fb_span, not for a GL batch).
+ */
+#include "../Shared/work_stealing_pool.h"
+#include "arena.h"
+#include "scanline.h"
+
+/// bands per thread; more than one, so a thread whose bands are cheap
+/// steals from one whose bands are expensive
+const int BANDS_PER_THREAD = 4;
+
+/**
+ * scanline_fill_bands(edge_table&,arena&,work_stealing_pool&,Span&) -
+ *                      scanline_fill with the scanlines cut into bands
+ *                      filled in parallel on the pool. The active lists
+ *                      of the bands come from the arena.
+ */
+template <class Span>
+inline void scanline_fill_bands(edge_table &table, arena &frame, work_stealing_pool &pool, Span &span)
+{
+    if(table.count == 0) return;
+
+    int rows = table.maxy-table.miny+1;
+    int height = (rows + BANDS_PER_THREAD*pool.size()-1) / (BANDS_PER_THREAD*pool.size());
+    int bands = (rows + height-1) / height;
+
+    /// edges crossing each band: +1 in the band of ymin, -1 after the band
+    /// of ymax, summed up
+    int *room = arena_array<int>(frame, bands+1);
+    fill(room, room+bands+1, 0);
+    for (int j = 0; j<table.count; j++)
+    {
+        room[(table.edges[j].ymin-table.miny) / height]++;
+        room[(table.edges[j].ymax-table.miny) / height + 1]--;
+    }
+
+    active_edge **active = arena_array<active_edge*>(frame, bands);
+    for (int b = 0, crossing = 0; b<bands; b++)
+    {
+        crossing += room[b];
+        active[b] = arena_array<active_edge>(frame, crossing);
+    }
+
+    pool.run(bands, [&](int b)
+    {
+        int y0 = table.miny + b*height;
+        fill_rows(table, y0, min(table.maxy, y0+height-1), active[b], span);
+    });
+}
+
+#endif // BANDS_H_INCLUDED
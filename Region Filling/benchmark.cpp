@@ -0,0 +1,219 @@
+/**
+ * Benchmark of the scanline fill on large polygons
+ *
+ * Fills polygons of many vertices with the integer edge walker of
+ * scanline_fill and with the floating point one of scanline_fill_float
+ * and reports the time of a fill, the spans per second and the speedup.
+ * The spans only go into a counter, so what is timed is the edge table
+ * walk itself. Then the spans are written into a framebuffer, once as
+ * row fills (fb_span) and once as lines (fb_line, what every span used
+ * to be), to show what the pixels cost. Last the row fills are done
+ * in horizontal bands on a thread pool (scanline_fill_bands) and the
+ * framebuffer is compared with the one of the serial fill. Then the
+ * anti-aliased coverage fill (coverage.h) is timed against the aliased
+ * row fill, split into accumulating the edges and resolving the buffer
+ * into pixels. It needs no window, so it can run on any machine.
+ *
+ *  star  vertices around a circle at random radii; many short edges
+ *  comb  teeth over the whole height; every edge is active on most rows
+ *
+ * Usage: benchmark [vertices] [rounds] [star|comb|all] [threads]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include "../Shared/framebuffer.h"
+#include "scanline.h"
+#include "bands.h"
+#include "coverage.h"
+
+const int SIZE = 4000;
+
+/**
+ * make_polygon(vector< pair<int,int> >&,int,const char*) - n vertices of
+ *                      the shape, inside -SIZE/2..SIZE/2-1.
+ */
+void make_polygon(vector< pair<int,int> > &vertex, int n, const char *shape)
+{
+    srand(1);
+    vertex.clear();
+    const double PI = acos(-1.0);
+    if(strcmp(shape, "star") == 0)
+    {
+        for (int i = 0; i<n; i++)
+        {
+            double a = 2*PI*i/n, r = i%2 ? SIZE/2-1 : rand()%(SIZE/2);
+            vertex.push_back(make_pair((int)floor(r*cos(a)), (int)floor(r*sin(a))));
+        }
+        return;
+    }
+
+    /// comb: teeth from the bottom up to random heights, left to right
+    int teeth = max(1, n/2 - 1);
+    for (int i = 0; i<teeth; i++)
+    {
+        int x = -SIZE/2 + (long long)i*(SIZE-1)/teeth;
+        vertex.push_back(make_pair(x, -SIZE/2 + 1 + rand()%8));
+        vertex.push_back(make_pair(x + (SIZE-1)/teeth/2, SIZE/2 - 1 - rand()%(SIZE/8)));
+    }
+    vertex.push_back(make_pair(SIZE/2-1, -SIZE/2));
+    vertex.push_back(make_pair(-SIZE/2, -SIZE/2));
+}
+
+/**
+ * span_counter - a span sink that only counts the spans and pixels. The
+ *                floating point x are rounded the way fb_line does.
+ */
+struct span_counter
+{
+    long long spans, pixels;
+    span_counter() : spans(0), pixels(0) {}
+
+    void operator()(int y, int xl, int xr)
+    {
+        spans++;
+        pixels += xr - xl + 1;
+    }
+
+    void operator()(int y, double xl, double xr)
+    {
+        (*this)(y, (int)floor(xl+0.5), (int)floor(xr+0.5));
+    }
+};
+
+/**
+ * row_sink, line_sink - span sinks writing into a framebuffer, as row
+ *                       fills or as horizontal lines.
+ */
+struct row_sink
+{
+    framebuffer &fb;
+    row_sink(framebuffer &f) : fb(f) {}
+    void operator()(int y, int xl, int xr) { fb_span(fb, y, xl, xr); }
+};
+
+struct line_sink
+{
+    framebuffer &fb;
+    line_sink(framebuffer &f) : fb(f) {}
+    void operator()(int y, int xl, int xr) { fb_line(fb, xl, y, xr, y); }
+};
+
+/**
+ * bench(const char*,int,int,work_stealing_pool&) - times both walkers,
+ *                      both framebuffer sinks, the band fill and the
+ *                      anti-aliased fill on one polygon.
+ */
+void bench(const char *shape, int n, int rounds, work_stealing_pool &pool)
+{
+    vector< pair<int,int> > vertex;
+    make_polygon(vertex, n, shape);
+
+    arena frame;
+    edge_table table;
+    arena_init(frame, 0);
+    build_edge_table(frame, &vertex[0], vertex.size(), table);
+
+    double best[2] = {1e100, 1e100};
+    span_counter count[2];
+    for (int r = 0; r<rounds; r++)
+    {
+        for (int walker = 0; walker<2; walker++)
+        {
+            span_counter spans;
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            if(walker == 0) scanline_fill(table, spans);
+            else scanline_fill_float(table, spans);
+            double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+            best[walker] = min(best[walker], sec);
+            count[walker] = spans;
+        }
+    }
+
+    printf("%-5s %7d vertices %8lld spans %11lld pixels\n", shape, (int)vertex.size(), count[0].spans, count[0].pixels);
+    printf("      integer  %9.3f ms %8.1f Mspans/s\n", best[0]*1e3, count[0].spans/best[0]/1e6);
+    printf("      float    %9.3f ms %8.1f Mspans/s\n", best[1]*1e3, count[1].spans/best[1]/1e6);
+    printf("      speedup  %9.2fx", best[1]/best[0]);
+    if(count[1].pixels != count[0].pixels)
+        printf("   (float rounding gives %+lld pixels)", count[1].pixels - count[0].pixels);
+    printf("\n");
+
+    framebuffer fb;
+    fb_init(fb, -SIZE/2, -SIZE/2, SIZE, SIZE);
+    row_sink rows(fb);
+    line_sink lines(fb);
+    double fill[2] = {1e100, 1e100};
+    for (int r = 0; r<rounds; r++)
+    {
+        for (int sink = 0; sink<2; sink++)
+        {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            if(sink == 0) scanline_fill(table, rows);
+            else scanline_fill(table, lines);
+            fill[sink] = min(fill[sink], chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        }
+    }
+
+    double bytes = count[0].pixels*4.0;
+    printf("      fb_span  %9.3f ms %8.2f GB/s of pixels\n", fill[0]*1e3, bytes/fill[0]/1e9);
+    printf("      fb_line  %9.3f ms %8.2f GB/s of pixels\n", fill[1]*1e3, bytes/fill[1]/1e9);
+
+    /// the serial image, then the band fill on a cleared framebuffer
+    fb_clear(fb);
+    scanline_fill(table, rows);
+    vector<unsigned int> serial = fb.pixels;
+
+    double banded = 1e100;
+    for (int r = 0; r<rounds; r++)
+    {
+        fb_clear(fb);
+        arena_reset(frame);
+        build_edge_table(frame, &vertex[0], vertex.size(), table);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        scanline_fill_bands(table, frame, pool, rows);
+        banded = min(banded, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+
+    printf("      bands    %9.3f ms %8.2f GB/s of pixels on %d threads, %.2fx, %s\n", banded*1e3, bytes/banded/1e9,
+           pool.size(), fill[0]/banded, fb.pixels == serial ? "same image" : "IMAGE DIFFERS");
+
+    coverage_buffer cov;
+    cov_init(cov, -SIZE/2, -SIZE/2, SIZE, SIZE);
+    int end = vertex.size();
+    double accumulate = 1e100, resolve = 1e100, antialiased = 1e100;
+    for (int r = 0; r<rounds; r++)
+    {
+        fb_clear(fb);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        cov_path(cov, &vertex[0], &end, 1);
+        chrono::steady_clock::time_point middle = chrono::steady_clock::now();
+        cov_resolve(cov, fb, EVEN_ODD);
+        chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+
+        accumulate = min(accumulate, chrono::duration<double>(middle - start).count());
+        resolve = min(resolve, chrono::duration<double>(stop - middle).count());
+        antialiased = min(antialiased, chrono::duration<double>(stop - start).count());
+    }
+
+    printf("      coverage %9.3f ms  (edges %.3f ms, resolve %.3f ms), %.2fx the time of fb_span\n",
+           antialiased*1e3, accumulate*1e3, resolve*1e3, antialiased/fill[0]);
+    arena_free(frame);
+}
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1 ? atoi(argv[1]) : 20000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    const char *which = argc > 3 ? argv[3] : "all";
+    work_stealing_pool pool(argc > 4 ? atoi(argv[4]) : thread::hardware_concurrency());
+
+    const char *shapes[] = {"star", "comb"};
+    for (int s = 0; s<2; s++)
+        if(strcmp(which, "all") == 0 || strcmp(which, shapes[s]) == 0)
+            bench(shapes[s], n, max(1, rounds), pool);
+
+    return EXIT_SUCCESS;
+}
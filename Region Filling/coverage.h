@@ -0,0 +1,265 @@
+#ifndef COVERAGE_H_INCLUDED
+#define COVERAGE_H_INCLUDED
+
+/**
+ * Anti-aliased polygon fill by coverage accumulation
+ *
+ * The aliased scanline fill only asks whether the center of a pixel is
+ * inside; its edges get stairs. Here every pixel gets the share of its
+ * square the polygon covers, computed exactly from the edges instead of
+ * by sampling, the way font rasterizers do.
+ *
+ * Pixel (x,y) is the unit square around the point (x,y), so the vertices
+ * lie on pixel centers as in the scanline fill. Every edge adds, to each
+ * cell of the rows it crosses, the signed area it sweeps in that cell
+ * towards the right, +dy going up and -dy going down. Summed from the
+ * left end of a row, the cells give the winding number of each pixel,
+ * fractional where an edge passes through it; that is the coverage. Only
+ * the cells an edge passes through are touched, so drawing the edges
+ * costs about as much as their length, and the one prefix sum per row,
+ * four cells at a time with SSE2, costs about as much as a clear.
+ *
+ * The fill rule turns the sum into coverage: NON_ZERO takes |sum| up to
+ * 1, EVEN_ODD folds it into 0..1..0 with period 2.
+ */
+#include <math.h>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "../Shared/framebuffer.h"
+#include "scanline.h"
+using namespace std;
+
+/**
+ * coverage_buffer - the signed area cells of a surface laid out like
+ *                   framebuffer; row r starts at area[r*stride]. A row
+ *                   has two cells more than pixels, as an edge on the
+ *                   right border adds to the cells right of it. Rows lo
+ *                   to hi were touched since the last resolve.
+ */
+struct coverage_buffer
+{
+    int left, bottom;
+    int width, height;
+    int stride;
+    vector<float> area;
+    int lo, hi;
+};
+
+inline void cov_init(coverage_buffer &cov, int left, int bottom, int width, int height)
+{
+    cov.left = left;
+    cov.bottom = bottom;
+    cov.width = width;
+    cov.height = height;
+    cov.stride = (width+2 + 3) & ~3;
+    cov.area.assign((size_t)cov.stride*height, 0);
+    cov.lo = height;
+    cov.hi = -1;
+}
+
+/**
+ * cov_segment(coverage_buffer&,float,float,float,float) - accumulates the
+ *                      segment (x0,y0)-(x1,y1) given in cells, with x in
+ *                      0..width. Rows outside the buffer are skipped.
+ */
+inline void cov_segment(coverage_buffer &cov, float x0, float y0, float x1, float y1)
+{
+    if(y0 == y1) return;
+
+    float dir = 1;
+    if(y0 > y1)
+    {
+        swap(x0, x1);
+        swap(y0, y1);
+        dir = -1;
+    }
+
+    float dxdy = (x1-x0) / (y1-y0);
+    float x = x0;
+    if(y0 < 0) x = min(max(x - y0*dxdy, 0.0f), (float)cov.width);
+
+    int ystart = max(0, (int)floor(y0)), yend = min(cov.height, (int)ceil(y1));
+    if(ystart >= yend) return;
+    cov.lo = min(cov.lo, ystart);
+    cov.hi = max(cov.hi, yend-1);
+
+    for (int y = ystart; y<yend; y++)
+    {
+        float *row = &cov.area[(size_t)y*cov.stride];
+        float dy = min(y+1.0f, y1) - max((float)y, y0);
+        float xnext = min(max(x + dxdy*dy, 0.0f), (float)cov.width);
+        float d = dy*dir;
+
+        float xl = min(x, xnext), xr = max(x, xnext);
+        float xlfloor = floor(xl), xrceil = ceil(xr);
+        int xli = xlfloor, xri = xrceil;
+
+        if(xri <= xli+1)
+        {
+            /// within one cell: the part right of the mean x goes to the next
+            float xmf = 0.5f*(x+xnext) - xlfloor;
+            row[xli] += d - d*xmf;
+            row[xli+1] += d*xmf;
+        }
+        else
+        {
+            /// a triangle in the first and the last cell, the cells in
+            /// between get an even share of dy each
+            float s = 1 / (xr-xl);
+            float xlf = xl - xlfloor;
+            float a0 = 0.5f*s*(1-xlf)*(1-xlf);
+            float xrf = xr - xrceil + 1;
+            float am = 0.5f*s*xrf*xrf;
+
+            row[xli] += d*a0;
+            if(xri == xli+2) row[xli+1] += d*(1 - a0 - am);
+            else
+            {
+                float a1 = s*(1.5f - xlf);
+                row[xli+1] += d*(a1 - a0);
+                for (int xi = xli+2; xi<xri-1; xi++)
+                    row[xi] += d*s;
+                float a2 = a1 + (xri-xli-3)*s;
+                row[xri-1] += d*(1 - a2 - am);
+            }
+            row[xri] += d*am;
+        }
+        x = xnext;
+    }
+}
+
+/**
+ * cov_line(coverage_buffer&,double,double,double,double) - accumulates the
+ *                      edge (x1,y1)-(x2,y2) in pixel co-ordinates. The
+ *                      parts left or right of the buffer are moved onto
+ *                      its border, which gives the pixels inside the same
+ *                      winding.
+ */
+inline void cov_line(coverage_buffer &cov, double x1, double y1, double x2, double y2)
+{
+    double X1 = x1 - cov.left + 0.5, Y1 = y1 - cov.bottom + 0.5;
+    double X2 = x2 - cov.left + 0.5, Y2 = y2 - cov.bottom + 0.5;
+    if(Y1 == Y2) return;
+
+    /// cut where the edge crosses x = 0 and x = width
+    double t[4] = {0, 0, 0, 0}, dx = X2-X1;
+    int cuts = 1;
+    for (int border = 0; border<2; border++)
+    {
+        double u = dx == 0 ? 0 : ((border ? cov.width : 0) - X1) / dx;
+        if(u > 0 && u < 1) t[cuts++] = u;
+    }
+    t[cuts++] = 1;
+    sort(t, t+cuts);
+
+    for (int k = 0; k+1<cuts; k++)
+    {
+        double xa = X1 + t[k]*dx, xb = X1 + t[k+1]*dx;
+        double ya = Y1 + t[k]*(Y2-Y1), yb = Y1 + t[k+1]*(Y2-Y1);
+        cov_segment(cov, min(max(xa, 0.0), (double)cov.width), ya, min(max(xb, 0.0), (double)cov.width), yb);
+    }
+}
+
+/**
+ * cov_path(coverage_buffer&,const pair<int,int>*,const int*,int) - the
+ *                      edges of every closed contour of a path, stored as
+ *                      for build_edge_table.
+ */
+inline void cov_path(coverage_buffer &cov, const pair<int,int> *vertex, const int *end, int contours)
+{
+    for (int c = 0, start = 0; c<contours; start = end[c++])
+        for (int i = start; i<end[c]; i++)
+        {
+            const pair<int,int> &a = vertex[i], &b = vertex[i+1 == end[c] ? start : i+1];
+            cov_line(cov, a.first, a.second, b.first, b.second);
+        }
+}
+
+/**
+ * cov_row_coverage(float*,int,fill_rule) - turns the n cells of a row into
+ *                      the coverage of its pixels: a prefix sum, then the
+ *                      fill rule. With SSE2 four cells at a time; the sum
+ *                      of four is two shifted adds, and the last lane is
+ *                      carried into the next four.
+ */
+inline void cov_row_coverage(float *cell, int n, fill_rule rule)
+{
+    int x = 0;
+    float sum = 0;
+#ifdef __SSE2__
+    const __m128 sign = _mm_set1_ps(-0.0f), one = _mm_set1_ps(1), two = _mm_set1_ps(2), half = _mm_set1_ps(0.5f);
+    __m128 carry = _mm_setzero_ps();
+    for (; x+4<=n; x+=4)
+    {
+        __m128 v = _mm_loadu_ps(cell+x);
+        v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)));
+        v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 8)));
+        v = _mm_add_ps(v, carry);
+        carry = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3,3,3,3));
+
+        __m128 a = _mm_andnot_ps(sign, v);
+        if(rule == EVEN_ODD)
+        {
+            a = _mm_sub_ps(a, _mm_mul_ps(two, _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(a, half)))));
+            a = _mm_min_ps(a, _mm_sub_ps(two, a));
+        }
+        else a = _mm_min_ps(a, one);
+        _mm_storeu_ps(cell+x, a);
+    }
+    sum = _mm_cvtss_f32(carry);
+#endif
+    for (; x<n; x++)
+    {
+        sum += cell[x];
+        float a = fabs(sum);
+        if(rule == EVEN_ODD)
+        {
+            a -= 2*(int)(a*0.5f);
+            a = min(a, 2-a);
+        }
+        else a = min(a, 1.0f);
+        cell[x] = a;
+    }
+}
+
+/**
+ * cov_resolve(coverage_buffer&,framebuffer&,fill_rule) - blends the
+ *                      current color of fb over its pixels by their
+ *                      coverage and clears the touched rows for the next
+ *                      path. fb must have the size and place of cov.
+ */
+inline void cov_resolve(coverage_buffer &cov, framebuffer &fb, fill_rule rule)
+{
+    const unsigned char *src = (const unsigned char*)&fb.color;
+    for (int y = cov.lo; y<=cov.hi; y++)
+    {
+        float *cell = &cov.area[(size_t)y*cov.stride];
+        cov_row_coverage(cell, cov.width, rule);
+
+        unsigned int *pixel = &fb.pixels[(size_t)y*fb.width];
+        for (int x = 0; x<cov.width; x++)
+        {
+            /// alpha 0..256; most pixels are all out or all in
+            int a = cell[x]*256 + 0.5f;
+            if(a <= 0) continue;
+            if(a >= 256)
+            {
+                pixel[x] = fb.color;
+                continue;
+            }
+
+            unsigned char *dst = (unsigned char*)&pixel[x];
+            for (int k = 0; k<3; k++)
+                dst[k] = (src[k]*a + dst[k]*(256-a)) >> 8;
+        }
+        memset(cell, 0, cov.stride*sizeof(float));
+    }
+    cov.lo = cov.height;
+    cov.hi = -1;
+}
+
+#endif // COVERAGE_H_INCLUDED
@@ -1,7 +1,9 @@
 #ifndef HEADERS_H_INCLUDED
 #define HEADERS_H_INCLUDED
 
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 #ifdef __APPLE__
 #include <GLUT/glut.h>
@@ -17,6 +19,7 @@
 #include <algorithm>
 #include <cstdio>
 #include <cctype>
+#include <cmath>
 #include <set>
 #define pb push_back
 #define mp make_pair
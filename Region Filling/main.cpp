@@ -7,38 +7,126 @@
  * using Scanline Region Filling Algorithm.
  */
 #include "headers.h"
+#include "../Shared/framebuffer.h"
+#include "scanline.h"
+#include "bands.h"
+#include "coverage.h"
 
+/**
+ * Headless mode (-headless out.ppm): no window is opened. Everything is
+ * drawn into the software framebuffer "screen" and the one frame is
+ * written to out.ppm, so the program also runs without a display.
+ */
+const char *headless_output = NULL;
+framebuffer screen;
+
+/**
+ * With software_backend (-software, and always in headless mode) spans go
+ * straight into the rows of "screen", which is shown with one
+ * glDrawPixels per frame. Otherwise the spans of a frame are collected in
+ * span_batch, two vertices each, and drawn with one glDrawArrays call.
+ */
+bool software_backend = false;
+vector<GLint> span_batch;
+
+/**
+ * vertex - the vertices of all contours of the path, one after another;
+ *          contour c ends before vertex[contour_end[c]]. rule - how the
+ *          contours fill, even-odd unless -nonzero.
+ */
 vector< pair<int,int> > vertex;
+vector<int> contour_end;
+fill_rule rule = EVEN_ODD;
 
-struct edge
+int miny, maxy;
+
+/**
+ * frame - the arena all scratch memory of a frame comes from, reset when
+ *         the frame starts; the first frame finds out how big it has to
+ *         be. table - the edge table of the frame.
+ */
+arena frame;
+edge_table table;
+
+/**
+ * pool - with -threads n, the threads filling the bands of the polygon in
+ *        parallel (bands.h); NULL fills on this thread only.
+ */
+work_stealing_pool *pool = NULL;
+
+/**
+ * With antialias (-antialias) the polygon is not filled by scanlines but
+ * by the coverage of every pixel (coverage.h), accumulated in coverage
+ * and blended into "screen".
+ */
+bool antialias = false;
+coverage_buffer coverage;
+
+
+/**
+ * SetColor(float,float,float) - glColor3f, or the drawing color of the
+ *                               framebuffer.
+ */
+void SetColor(float r, float g, float b)
 {
-    int xmin, ymin, ymax;
-    int pixelcount;
-    double  one_by_m;
-    edge( int xmin_, int ymin_, int ymax_, double one_by_m_)
-    {
-        ymin = ymin_;
-        xmin = xmin_;
-        ymax = ymax_;
-        one_by_m = one_by_m_;
-        pixelcount=1;
-    }
-};
+    if(software_backend) fb_color(screen, r, g, b);
+    else glColor3f(r, g, b);
+}
 
-bool comp(edge &a,edge &b)
+/**
+ * static_image - with the software backend, a copy of the framebuffer
+ *                holding only the static layer, taken the first time it
+ *                is drawn (static_cached).
+ */
+framebuffer static_image;
+bool static_cached = false;
+
+/**
+ * ClearScreen() - glClear, or clearing the framebuffer. Once the static
+ *                 layer is cached the framebuffer starts from a copy of
+ *                 it instead, which clears and draws the layer at once.
+ */
+void ClearScreen()
 {
-    return a.xmin<b.xmin;
+    if(software_backend)
+    {
+        if(static_cached) fb_blit(screen, static_image);
+        else fb_clear(screen);
+    }
+    else glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
-vector<edge>edges;
-int miny, maxy;
+/**
+ * ShowFrame() - glutSwapBuffers, after copying the framebuffer to the
+ *               window; nothing to show in headless mode.
+ */
+void ShowFrame()
+{
+    if(headless_output != NULL) return;
 
+    if(software_backend)
+    {
+        /**
+         * glRasterPos2i(int,int) - the bottom-left corner where
+         *                          glDrawPixels starts writing.
+         */
+        glRasterPos2i(screen.left, screen.bottom);
+        glDrawPixels(screen.width, screen.height, GL_RGBA, GL_UNSIGNED_BYTE, &screen.pixels[0]);
+    }
+    glutSwapBuffers();
+}
 
 /**
  * This function draws a line from (x1, y1) to (x2,y2) pixel co-ordinate.
  */
 void DrawLine(double x1, double  y1, double x2, double y2)
 {
+    if(software_backend)
+    {
+        fb_line(screen, x1, y1, x2, y2);
+        return;
+    }
+
     /**
      * glBegin(GLbitfield mask) - delimit the vertices of a primitive or
      *                            a group of like primitives
@@ -64,28 +152,99 @@ void DrawLine(double x1, double  y1, double x2, double y2)
     return;
 }
 
-void ListEdges(void)
+/**
+ * DrawSpan(int,int,int) - the span xl..xr of scanline y: a vectorized row
+ *                         fill of the framebuffer, or one more line of
+ *                         the GL batch.
+ */
+void DrawSpan(int y, int xl, int xr)
 {
-    edges.clear();
-
-    for(int i=0,j=1; i<vertex.size(); i++,j++)
+    if(software_backend)
     {
-        j%=vertex.size();
-        if(vertex[i].second!=vertex[j].second)
-            edges.pb(edge((vertex[i].second<vertex[j].second? vertex[i].first:vertex[j].first),
-            min(vertex[i].second,vertex[j].second), max(vertex[i].second,vertex[j].second),
-            (vertex[j].first - vertex[i].first) / (vertex[j].second*1.0-vertex[i].second)));
+        fb_span(screen, y, xl, xr);
+        return;
     }
 
-    set<int>todecrease;
+    span_batch.pb(xl);
+    span_batch.pb(y);
+    span_batch.pb(xr);
+    span_batch.pb(y);
+}
+
+/**
+ * FlushSpans() - draws the batched spans of the frame as GL_LINES with a
+ *                single glDrawArrays call. The batch keeps its memory for
+ *                the next frame.
+ */
+void FlushSpans()
+{
+    if(span_batch.empty()) return;
+
+    /**
+     * glVertexPointer(GLint size, GLenum type, GLsizei stride, const void*) -
+     *                          where the vertex positions are, two ints
+     *                          each; glDrawArrays(GL_LINES, first, count)
+     *                          then joins every two of them by a line.
+     */
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_INT, 0, &span_batch[0]);
+    glDrawArrays(GL_LINES, 0, span_batch.size()/2);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    span_batch.clear();
+}
+
+/**
+ * StaticLayer() - the part of the picture that never changes between
+ *                 frames.
+ */
+void StaticLayer()
+{
+    SetColor(1,0,0); // cyan color
+    DrawLine(-350,0,350,0);
+    DrawLine(0,-350,0,350);
+}
 
-    for(int i=0; i<edges.size(); i++)
+GLuint static_list = 0;
+
+/**
+ * DrawStaticLayer() - draws the axes. They never change between frames,
+ *                     so the first call records them into a display list
+ *                     and later calls only replay it. The framebuffer
+ *                     keeps the first drawing in static_image instead,
+ *                     and ClearScreen has put it back already.
+ */
+void DrawStaticLayer()
+{
+    if(software_backend)
     {
-        for (int j = 0; j<edges.size(); j++)
-        if(edges[j].ymin==edges[i].ymax) todecrease.insert(i);
+        if(static_cached) return;
+
+        StaticLayer();
+        static_image = screen;
+        static_cached = true;
+        return;
     }
 
-    for(auto now:todecrease) edges[now].ymax--;
+    if(static_list != 0)
+    {
+        /**
+         * glCallList(GLuint list) - executes the commands recorded in
+         *                           the display list.
+         */
+        glCallList(static_list);
+        return;
+    }
+
+    /**
+     * glNewList(GLuint list, GLenum mode) - starts recording GL commands
+     *                          into a display list. GL_COMPILE_AND_EXECUTE
+     *                          also runs them while recording.
+     */
+    static_list = glGenLists(1);
+    glNewList(static_list, GL_COMPILE_AND_EXECUTE);
+    StaticLayer();
+    glEndList();
 }
 
 void scanline_algo()
@@ -95,57 +254,38 @@ void scanline_algo()
      * GL_COLOR_BUFFER_BIT - Indicates the buffers currently
      *                       enabled for color writing
      */
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    glColor3f(1,0,0); // cyan color
+    ClearScreen();
 
+    DrawStaticLayer();
 
-    DrawLine(-350,0,350,0);
-    DrawLine(0,-350,0,350);
+    arena_reset(frame);
+    build_edge_table(frame, &vertex[0], &contour_end[0], contour_end.size(), rule, table);
 
-    ListEdges();
+    cout<<"Edges = "<< table.count<<" ymn = "<<miny<<" ymx "<<maxy<<endl;
+    cout<<"Vertices = "<< vertex.size()<<" contours = "<<contour_end.size()<<endl;
 
-    cout<<"Edges = "<< edges.size()<<" ymn = "<<miny<<" ymx "<<maxy<<endl;
-    cout<<"Vertices = "<< vertex.size()<<endl;
-
-    for ( auto now : edges )
-        cout<<"ymin = "<< now.ymin<<" ymax = "<<now.ymax<<" x = "<< now.xmin <<" 1/m = "<< now.one_by_m <<" count = "<< now.pixelcount <<endl;
+    for (int j = 0; j<table.count; j++)
+    {
+        const edge &now = table.edges[j];
+        cout<<"ymin = "<< now.ymin<<" ymax = "<<now.ymax<<" x = "<< now.xmin <<" 1/m = "<< now.one_by_m <<endl;
+    }
 
     /**
     * void glColor3f(GLfloat red, GLfloat green, GLfloat blue) -
     *          set RGB color.
     */
-    glColor3f(1, 1, 0);
+    SetColor(1, 1, 0);
 
-    for (int i = miny; i<=maxy; i++)
+    if(antialias)
     {
-        vector<double>xs;
-        for (int j = 0; j<edges.size(); j++)
-        {
-            if(edges[j].ymin<=i && i<=edges[j].ymax)
-            {
-                xs.pb(edges[j].xmin+edges[j].one_by_m*edges[j].pixelcount);
-                edges[j].pixelcount++;
-            }
-        }
-
-        sort(all(xs));
-
-        for (int j = 0; j<xs.size(); j+=2)
-            DrawLine(xs[j],i,xs[j+1],i);
-
-        for(auto it = edges.begin(); it!=edges.end(); it++)
-        {
-            if((*it).ymax==i)
-            {
-                edges.erase(it);
-                it--;
-            }
-        }
-
+        cov_path(coverage, &vertex[0], &contour_end[0], contour_end.size());
+        cov_resolve(coverage, screen, rule);
     }
+    else if(pool != NULL) scanline_fill_bands(table, frame, *pool, DrawSpan);
+    else scanline_fill(table, DrawSpan);
+    FlushSpans();
 
-    glutSwapBuffers();
+    ShowFrame();
     return;
 }
 
@@ -155,64 +295,103 @@ void scanline_algo()
 int main(int argc, char *argv[])
 {
     /**
-     * glutInit(int, char*) - initializes glut environment.
-     */
-    glutInit(&argc, argv);
-    /**
-     * glutInitWindowSize(int,int)- initializes new glut window of
-     *                              size W * H
-     *                              default: 300, 300
-     */
-    glutInitWindowSize(700,700);
-    /**
-     * glutInitWindowPosition(int,int) - set the origin of the
-     *                                   co-ordinate
-     *                                   default: -1, -1
-     */
-    glutInitWindowPosition(10,10);
-
-    /**
-     * glutInitDisplayMode(unsigned int) - set the initial display mode.
-     *                      It can take a combinations of some masks
-     *                      which are not overlapped in their binary
-     *                      representation. So, it takes them having
-     *                      bitwise OR.
-     * GLUT_RGB - the color input would by set by RGB values.
-     * GLUT_DOUBLE - makes it double buffered. It is like using two blackboard.
-     *               One blackboard would be shown to the screen and hidden one
-     *               would be processed behind. they can be swapped any time.
-     * GLUT_DEPTH - It is mainly enables depth concept. Algorithm like z-buffering
-     *              could be done by using this.
+     * Command line options:
+     *  -headless out.ppm  no window; draw into the framebuffer and write
+     *                     the frame to out.ppm
+     *  -software          fill into the framebuffer and show it with one
+     *                     glDrawPixels per frame
+     *  -threads n         fill in horizontal bands on n threads; implies
+     *                     -software, as GL calls can't come from the workers
+     *  -multi             read a path of several contours: their number,
+     *                     then every contour as a polygon is read otherwise
+     *  -nonzero           fill by the non-zero winding rule, not even-odd
+     *  -antialias         fill with anti-aliased edges; implies -software
      */
-    glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
-
-    /**
-     * glutCreateWindow(char*) - creates a top-level window having the title
-     *                           given as parameter.
-     */
-    glutCreateWindow("Scanline Algorithm for Region Filling");
+    bool multi_contour = false;
+    for (int i = 1; i<argc; i++)
+    {
+        if(strcmp(argv[i], "-headless") == 0 && i+1<argc) headless_output = argv[++i];
+        else if(strcmp(argv[i], "-software") == 0) software_backend = true;
+        else if(strcmp(argv[i], "-threads") == 0 && i+1<argc) pool = new work_stealing_pool(atoi(argv[++i]));
+        else if(strcmp(argv[i], "-multi") == 0) multi_contour = true;
+        else if(strcmp(argv[i], "-nonzero") == 0) rule = NON_ZERO;
+        else if(strcmp(argv[i], "-antialias") == 0) antialias = true;
+    }
+    if(headless_output != NULL || pool != NULL || antialias) software_backend = true;
 
-    /**
-    * gluOrtho2D(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top) -
-    *                              define a 2D orthographic projection matrix
-    */
-    gluOrtho2D(-350,350,-350,350);
+    if(headless_output == NULL)
+    {
+        /**
+         * glutInit(int, char*) - initializes glut environment.
+         */
+        glutInit(&argc, argv);
+        /**
+         * glutInitWindowSize(int,int)- initializes new glut window of
+         *                              size W * H
+         *                              default: 300, 300
+         */
+        glutInitWindowSize(700,700);
+        /**
+         * glutInitWindowPosition(int,int) - set the origin of the
+         *                                   co-ordinate
+         *                                   default: -1, -1
+         */
+        glutInitWindowPosition(10,10);
+
+        /**
+         * glutInitDisplayMode(unsigned int) - set the initial display mode.
+         *                      It can take a combinations of some masks
+         *                      which are not overlapped in their binary
+         *                      representation. So, it takes them having
+         *                      bitwise OR.
+         * GLUT_RGB - the color input would by set by RGB values.
+         * GLUT_DOUBLE - makes it double buffered. It is like using two blackboard.
+         *               One blackboard would be shown to the screen and hidden one
+         *               would be processed behind. they can be swapped any time.
+         * GLUT_DEPTH - It is mainly enables depth concept. Algorithm like z-buffering
+         *              could be done by using this.
+         */
+        glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
+
+        /**
+         * glutCreateWindow(char*) - creates a top-level window having the title
+         *                           given as parameter.
+         */
+        glutCreateWindow("Scanline Algorithm for Region Filling");
+
+        /**
+        * gluOrtho2D(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top) -
+        *                              define a 2D orthographic projection matrix
+        */
+        gluOrtho2D(-350,350,-350,350);
+    }
+    if(software_backend) fb_init(screen, -350, -350, 700, 700);
+    if(antialias) cov_init(coverage, -350, -350, 700, 700);
 
-    int n,x,y;
+    int n,x,y,contours = 1;
 
-    printf("How many points? (at least 3): ");
-    scanf("%d", &n);
-    printf("Give %d points as input as: \"x y\":\n", n);
-    for (int i = 0; i<n; i++)
+    if(multi_contour)
     {
-        scanf("%d %d", &x, &y);
-        vertex.pb(mp(x,y));
+        printf("How many contours? ");
+        scanf("%d", &contours);
+    }
+    for (int c = 0; c<contours; c++)
+    {
+        printf("How many points? (at least 3): ");
+        scanf("%d", &n);
+        printf("Give %d points as input as: \"x y\":\n", n);
+        for (int i = 0; i<n; i++)
+        {
+            scanf("%d %d", &x, &y);
+            vertex.pb(mp(x,y));
+        }
+        contour_end.pb(vertex.size());
     }
 
     miny = vertex[0].second;
     maxy = vertex[0].second;
 
-    for (int i = 1; i<n; i++)
+    for (int i = 1; i<(int)vertex.size(); i++)
     {
         miny = min(miny, vertex[i].second);
         maxy = max(maxy, vertex[i].second);
@@ -220,6 +399,19 @@ int main(int argc, char *argv[])
 
 
 
+    if(headless_output != NULL)
+    {
+        double start = fb_clock_ms();
+        scanline_algo();
+        printf("Frame time: %.3f ms\n", fb_clock_ms() - start);
+        if(!fb_write_ppm(screen, headless_output))
+        {
+            printf("Could not write %s\n", headless_output);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
     /**
      * void glutDisplayFunc(void (*func)(void))  - this function takes a function pointer
      *                                             in which all works done.
@@ -255,4 +447,15 @@ int main(int argc, char *argv[])
 -200 100
 -200 -100
 -100 0
+
+9
+-48 -3
+-1 0
+-29 -277
+59 -239
+172 -142
+14 -2
+101 -11
+-45 181
+-1 2
 */
@@ -0,0 +1,400 @@
+#ifndef SCANLINE_H_INCLUDED
+#define SCANLINE_H_INCLUDED
+
+/**
+ * Scanline polygon fill
+ *
+ * The edges of the polygon go into an edge table, bucketed by the
+ * scanline they start on. Walking up the scanlines, the edges of each
+ * bucket join the active edge list, which is kept sorted by x, and leave
+ * it after their top scanline. Consecutive pairs of active edges bound
+ * the spans of the polygon on the scanline.
+ *
+ * The x of an edge on scanline y is xmin + k*dx/dy with k = y-ymin+1,
+ * but at most dy: an edge ending at a peak has its top vertex on its
+ * last scanline, and x must not run on past it. Two edges running on
+ * past their peak cross, and the even-odd pairs could go wrong.
+ * scanline_fill keeps it as an integer and an error term, Bresenham
+ * style, and carries the fraction over with additions only; rounding is
+ * exact, so every compiler gives the same pixels. scanline_fill_float is
+ * the previous floating point walk, kept for comparison.
+ *
+ * The edge table and the active list are arrays from the frame arena,
+ * sized from the vertex count up front, so a frame does no allocations
+ * of its own once the arena is big enough.
+ *
+ * A path may have several closed contours, e.g. an outline and its
+ * holes, or islands. The edges of all of them go into the one table and
+ * are filled in the same pass. Every edge remembers its direction,
+ * +1 going up and -1 going down; left of a point, the directions of the
+ * edges crossed add up to its winding number. The fill rule decides
+ * which points are inside:
+ *
+ *  EVEN_ODD  an odd number of edges to the left, whatever direction
+ *  NON_ZERO  a winding number other than 0; a hole must then run the
+ *            other way round than its outline
+ */
+#include <new>
+#include <vector>
+#include <algorithm>
+#include "arena.h"
+using namespace std;
+
+enum fill_rule { EVEN_ODD, NON_ZERO };
+
+/**
+ * floor_div(long long,long long) - a/b rounded down, for b > 0.
+ */
+inline long long floor_div(long long a, long long b)
+{
+    return a/b - (a%b < 0);
+}
+
+struct edge
+{
+    int xmin, ymin, ymax;
+    int dx, dy;     /// from the ymin end to the ymax end; dy > 0
+    int winding;    /// +1 if the contour goes up along the edge, else -1
+    double  one_by_m;
+
+    /// floating point walker: x = xmin + one_by_m*pixelcount
+    int pixelcount;
+    double fx;
+
+    /// integer walker increments, see active_edge
+    int step, rem2, dy2;
+
+    edge( int xmin_, int ymin_, int ymax_, int dx_, int dy_, int winding_)
+    {
+        ymin = ymin_;
+        xmin = xmin_;
+        ymax = ymax_;
+        dx = dx_;
+        dy = dy_;
+        winding = winding_;
+        one_by_m = dx / (dy*1.0);
+        pixelcount=1;
+        fx = xmin;
+
+        step = floor_div(dx, dy);
+        rem2 = 2*(dx - step*dy);
+        dy2 = 2*dy;
+    }
+};
+
+/**
+ * active_edge - an edge on the active list of the integer walker. On the
+ *               current scanline x + 1/2 is x + err/(2*dy) with
+ *               0 <= err < 2*dy; a scanline below top, the y of the top
+ *               vertex, adds step to x and rem2 to err. The list holds
+ *               copies, so fills of different bands never share one.
+ */
+struct active_edge
+{
+    int x, err;
+    int step, rem2, dy2;
+    int ymax;
+    int winding;
+    int top;        /// also pads it to 32 bytes; 28 make the sort moves slower
+};
+
+inline bool active_before(const active_edge &a, const active_edge &b)
+{
+    return a.x < b.x;
+}
+
+/**
+ * walker_at(const edge&,int) - the active_edge of e after k scanlines,
+ *                      jumped to directly: x + 1/2 is
+ *                      xmin + 1/2 + k*dx/dy.
+ */
+inline active_edge walker_at(const edge &e, int k)
+{
+    long long num = e.dy + 2LL*k*e.dx;
+    long long whole = floor_div(num, e.dy2);
+    active_edge a = {(int)(e.xmin + whole), (int)(num - whole*e.dy2), e.step, e.rem2, e.dy2, e.ymax, e.winding, e.ymin+e.dy};
+    return a;
+}
+
+/**
+ * edge_table - the edges of one frame, bucketed by ymin: the edges
+ *              starting on scanline y are edges[bucket[y-miny]] to
+ *              edges[bucket[y-miny+1]-1], so the edges starting below y
+ *              are the first bucket[y-miny]. active has room for the
+ *              active list of a fill, order for that of the float walker.
+ *              rule is the fill rule the fills use.
+ *
+ * All arrays are taken from the frame arena, so they are gone with the
+ * next arena_reset.
+ */
+struct edge_table
+{
+    edge *edges;
+    int count;
+    int miny, maxy;
+    int *bucket;
+    active_edge *active;
+    int *order;
+    fill_rule rule;
+};
+
+/**
+ * list_edges(const pair<int,int>*,int,edge*,char*) - writes the edges of
+ *                      the closed polygon of n vertices, in polygon order,
+ *                      to edges and returns how many. Horizontal edges are
+ *                      left out. up gets the direction of every edge.
+ *
+ * Where the polygon passes a vertex going on in the same direction, the
+ * edge below the vertex ends and the edge above starts on its scanline,
+ * which would count the vertex twice. The edge below then ends a scanline
+ * lower. At a peak or valley both edges are on the same side and the
+ * vertex rightly counts twice (or not at all). Horizontal edges between
+ * two edges don't change that, so only consecutive edges of the list are
+ * compared, in one pass.
+ */
+inline int list_edges(const pair<int,int> *vertex, int n, edge *edges, char *up)
+{
+    int count = 0;
+    for(int i=0,j=1; i<n; i++,j++)
+    {
+        j%=n;
+        if(vertex[i].second!=vertex[j].second)
+        {
+            up[count] = vertex[i].second<vertex[j].second;
+            const pair<int,int> &lo = up[count] ? vertex[i] : vertex[j], &hi = up[count] ? vertex[j] : vertex[i];
+            new (&edges[count]) edge(lo.first, lo.second, hi.second, hi.first-lo.first, hi.second-lo.second, up[count] ? 1 : -1);
+            count++;
+        }
+    }
+
+    for (int i = 0; i<count; i++)
+    {
+        int next = i+1 == count ? 0 : i+1;
+        if(up[i] != up[next]) continue;
+
+        /// going up, edge i is below the vertex; going down, next is
+        if(up[i]) edges[i].ymax--;
+        else edges[next].ymax--;
+    }
+    return count;
+}
+
+/**
+ * build_edge_table(arena&,const pair<int,int>*,const int*,int,fill_rule,
+ *                  edge_table&) - lists the edges of every contour of the
+ *                      path and sorts them into the buckets of their ymin,
+ *                      with a counting sort over the scanlines. Contour c
+ *                      ends before vertex end[c]; it starts where contour
+ *                      c-1 ends. Everything comes from the arena.
+ */
+inline void build_edge_table(arena &frame, const pair<int,int> *vertex, const int *end, int contours,
+                             fill_rule rule, edge_table &table)
+{
+    int n = contours ? end[contours-1] : 0;
+    table.count = 0;
+    table.rule = rule;
+    table.miny = n ? vertex[0].second : 0;
+    table.maxy = table.miny;
+    for (int i = 1; i<n; i++)
+    {
+        table.miny = min(table.miny, vertex[i].second);
+        table.maxy = max(table.maxy, vertex[i].second);
+    }
+
+    edge *listed = arena_array<edge>(frame, n);
+    char *up = arena_array<char>(frame, n);
+    for (int c = 0, start = 0; c<contours; start = end[c++])
+        if(end[c] > start)
+            table.count += list_edges(vertex+start, end[c]-start, listed+table.count, up+table.count);
+
+    int rows = table.maxy-table.miny+1;
+    table.bucket = arena_array<int>(frame, rows+1);
+    table.active = arena_array<active_edge>(frame, table.count);
+    table.order = arena_array<int>(frame, table.count);
+    table.edges = arena_array<edge>(frame, table.count);
+    int *next = arena_array<int>(frame, rows);
+
+    fill(table.bucket, table.bucket+rows+1, 0);
+    for (int j = 0; j<table.count; j++)
+        table.bucket[listed[j].ymin-table.miny+1]++;
+    for (int r = 0; r<rows; r++)
+        table.bucket[r+1] += table.bucket[r];
+
+    copy(table.bucket, table.bucket+rows, next);
+    for (int j = 0; j<table.count; j++)
+        table.edges[next[listed[j].ymin-table.miny]++] = listed[j];
+}
+
+/**
+ * build_edge_table(arena&,const pair<int,int>*,int,edge_table&) - the edge
+ *                      table of one polygon of n vertices, filled even-odd.
+ */
+inline void build_edge_table(arena &frame, const pair<int,int> *vertex, int n, edge_table &table)
+{
+    build_edge_table(frame, vertex, &n, 1, EVEN_ODD, table);
+}
+
+/**
+ * inside(fill_rule,int) - whether points of that winding number are inside
+ *                         under the rule.
+ */
+inline bool inside(fill_rule rule, int winding)
+{
+    return rule == EVEN_ODD ? (winding & 1) : winding != 0;
+}
+
+/**
+ * sort_active(active_edge*,int) - insertion sort of the active list by x.
+ *                      The list was sorted on the previous scanline and
+ *                      edges only swap where they cross, so this is about
+ *                      one pass.
+ */
+inline void sort_active(active_edge *active, int n)
+{
+    for (int j = 1; j<n; j++)
+    {
+        active_edge now = active[j];
+        int k = j;
+        for (; k>0 && active[k-1].x > now.x; k--)
+            active[k] = active[k-1];
+        active[k] = now;
+    }
+}
+
+/**
+ * seed_active(const edge_table&,int,active_edge*) - the active list at the
+ *                      start of scanline y0, before the edges of its own
+ *                      bucket join: every edge from below y0 that is still
+ *                      going, jumped y0-ymin scanlines. Returns its length.
+ */
+inline int seed_active(const edge_table &table, int y0, active_edge *active)
+{
+    int n = 0;
+    for (int j = 0; j<table.bucket[y0-table.miny]; j++)
+    {
+        const edge &e = table.edges[j];
+        if(e.ymax >= y0) active[n++] = walker_at(e, y0-e.ymin);
+    }
+    sort(active, active+n, active_before);
+    return n;
+}
+
+/**
+ * fill_rows(const edge_table&,int,int,active_edge*,Span&) - calls
+ *                      span(y,xl,xr) for every span of scanlines y0..y1,
+ *                      xl and xr the rounded edge x. active needs room for
+ *                      every edge crossing those scanlines. Nothing is
+ *                      allocated, and the table is not changed.
+ */
+template <class Span>
+inline void fill_rows(const edge_table &table, int y0, int y1, active_edge *active, Span &span)
+{
+    int count = seed_active(table, y0, active);
+    for (int i = y0; i<=y1; i++)
+    {
+        for (int j = table.bucket[i-table.miny]; j<table.bucket[i-table.miny+1]; j++)
+            active[count++] = walker_at(table.edges[j], 0);
+
+        for (int j = 0; j<count; j++)
+        {
+            active_edge &now = active[j];
+            /// no branch: the carry is 0 or 1, and on the scanline of its
+            /// top vertex an edge stays at the vertex
+            int going = -(i < now.top);
+            now.err += now.rem2 & going;
+            int carry = now.err >= now.dy2;
+            now.x += (now.step & going) + carry;
+            now.err -= carry*now.dy2;
+        }
+
+        /// rounding keeps the order, so the rounded x sort like the exact ones
+        sort_active(active, count);
+
+        if(table.rule == EVEN_ODD)
+        {
+            for (int j = 0; j+1<count; j+=2)
+                span(i, active[j].x, active[j+1].x);
+        }
+        else
+        {
+            /// a span runs from where the winding number leaves 0 to where
+            /// it comes back; edges in between don't end it
+            int winding = 0, xl = 0;
+            for (int j = 0; j<count; j++)
+            {
+                if(winding == 0) xl = active[j].x;
+                winding += active[j].winding;
+                if(winding == 0) span(i, xl, active[j].x);
+            }
+        }
+
+        /// edges ending on this scanline leave; the rest keep their order
+        int kept = 0;
+        for (int j = 0; j<count; j++)
+            if(active[j].ymax!=i) active[kept++] = active[j];
+        count = kept;
+    }
+}
+
+/**
+ * scanline_fill(edge_table&,Span&) - calls span(y,xl,xr) for every span of
+ *                      the polygon in the edge table, scanline by scanline.
+ */
+template <class Span>
+inline void scanline_fill(edge_table &table, Span &span)
+{
+    fill_rows(table, table.miny, table.maxy, table.active, span);
+}
+
+/**
+ * scanline_fill_float(edge_table&,Span&) - scanline_fill with x computed in
+ *                      floating point as xmin + one_by_m*pixelcount, the
+ *                      count at most dy; span gets the unrounded x.
+ */
+template <class Span>
+inline void scanline_fill_float(edge_table &table, Span &span)
+{
+    edge *edges = table.edges;
+    int *order = table.order, count = 0;
+
+    for (int i = table.miny; i<=table.maxy; i++)
+    {
+        for (int j = table.bucket[i-table.miny]; j<table.bucket[i-table.miny+1]; j++)
+        {
+            edges[j].pixelcount = 1;
+            order[count++] = j;
+        }
+
+        for (int j = 0; j<count; j++)
+        {
+            edge &now = edges[order[j]];
+            now.fx = now.xmin+now.one_by_m*min(now.pixelcount, now.dy);
+            now.pixelcount++;
+        }
+
+        for (int j = 1; j<count; j++)
+        {
+            int now = order[j], k = j;
+            for (; k>0 && edges[order[k-1]].fx > edges[now].fx; k--)
+                order[k] = order[k-1];
+            order[k] = now;
+        }
+
+        int winding = 0;
+        double xl = 0;
+        for (int j = 0; j<count; j++)
+        {
+            const edge &now = edges[order[j]];
+            if(!inside(table.rule, winding)) xl = now.fx;
+            winding += now.winding;
+            if(!inside(table.rule, winding)) span(i, xl, now.fx);
+        }
+
+        int kept = 0;
+        for (int j = 0; j<count; j++)
+            if(edges[order[j]].ymax!=i) order[kept++] = order[j];
+        count = kept;
+    }
+}
+
+#endif // SCANLINE_H_INCLUDED
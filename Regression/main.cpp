@@ -0,0 +1,365 @@
+/**
+ * Golden image and performance regression harness
+ *
+ * Every program keeps its test cases in the comment block at the bottom
+ * of its main.cpp, one case per paragraph. This harness feeds each case
+ * to the program in headless mode, hashes the image it writes and
+ * compares the hash with golden.txt. It also times every case (best of
+ * several runs) and compares with the baseline in timing.txt, which is
+ * written on the first run of a machine. The time is the frame time the
+ * program prints ("Frame time: <ms> ms"), without the start of the
+ * process and the shell; a program which prints none is timed as a whole.
+ *
+ * A case fails when its image differs from the golden one, or when it
+ * is more than the threshold, and more than the slack, slower than its
+ * baseline; a fraction of a millisecond of a short frame is noise rather
+ * than a slower rasterizer. A program run
+ * with other options may also have to draw the very same image as
+ * another one, e.g. Region Filling by the non-zero rule, whose cases are
+ * simple polygons, the same as by the even-odd rule. The image of a
+ * failed case is kept as "<program> <case>.ppm" next to the harness.
+ *
+ * Usage: regress [-update] [-threshold percent] [-slack ms] [-runs n]
+ *                [-root dir] [-target Release|Debug]
+ *
+ *  -update      take the current images and times as the new golden
+ *               hashes and baselines
+ *  -slack ms    how much slower a case must be at least to be SLOW,
+ *               1 ms by default
+ *  -root dir    the repository, ".." by default (run from Regression)
+ *  -target      which Code::Blocks build of the programs to run
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * program - where a program lives and how it is run headless. same_as
+ *           names an earlier program whose image every case must match,
+ *           or is empty.
+ */
+struct program
+{
+    const char *name;
+    const char *directory;
+    const char *executable;
+    const char *options;
+    const char *same_as;
+};
+
+const program programs[] =
+{
+    {"Line Drawing", "Line Drawing", "Bresenham's Algorithm", "", ""},
+    {"Line Drawing antialias", "Line Drawing", "Bresenham's Algorithm", "-antialias", ""},
+    {"Region Filling", "Region Filling", "Scanline Algorithm", "", ""},
+    {"Region Filling nonzero", "Region Filling", "Scanline Algorithm", "-nonzero", "Region Filling"},
+    {"Transformation", "Transformation", "Transformation2D", "", ""},
+    {"Line Clipping", "Line Clipping", "Liang-Barsky Algorithm", "", ""},
+    {"Projection", "Projection", "Pejection of Cube", "", ""},
+    {"Animation", "Animation", "Moving Objects", "-time 1", ""},
+};
+
+const int PROGRAMS = sizeof(programs) / sizeof(programs[0]);
+
+const char *INPUT_FILE = "regress_input.txt";
+const char *OUTPUT_FILE = "regress_output.ppm";
+const char *LOG_FILE = "regress_log.txt";
+
+/**
+ * read_file(const string&,string&) - the whole file; false if unreadable.
+ */
+bool read_file(const string &path, string &text)
+{
+    FILE *fp = fopen(path.c_str(), "rb");
+    if(fp == NULL) return false;
+
+    char buffer[65536];
+    size_t n;
+    text.clear();
+    while((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        text.append(buffer, n);
+    fclose(fp);
+    return true;
+}
+
+/**
+ * test_cases(const string&) - the paragraphs of the last comment block of
+ *                             a source file. No block gives one empty case.
+ */
+vector<string> test_cases(const string &source)
+{
+    vector<string> cases;
+    size_t open = source.rfind("/**"), close = source.rfind("*/");
+    if(open == string::npos || close == string::npos || close < open)
+    {
+        cases.push_back("");
+        return cases;
+    }
+
+    string block = source.substr(open+3, close-open-3), current;
+    size_t at = 0;
+    while(at <= block.size())
+    {
+        size_t end = block.find('\n', at);
+        if(end == string::npos) end = block.size();
+        string line = block.substr(at, end-at);
+        if(!line.empty() && line[line.size()-1] == '\r') line.erase(line.size()-1);
+
+        if(line.find_first_not_of(" \t") == string::npos)
+        {
+            if(!current.empty()) cases.push_back(current);
+            current.clear();
+        }
+        else current += line + "\n";
+        at = end+1;
+    }
+    if(!current.empty()) cases.push_back(current);
+    if(cases.empty()) cases.push_back("");
+    return cases;
+}
+
+/**
+ * image_hash(const string&) - 64 bit FNV-1a of the image file, in hex.
+ */
+string image_hash(const string &image)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i<image.size(); i++)
+        h = (h ^ (unsigned char)image[i]) * 1099511628211ULL;
+
+    char hex[17];
+    sprintf(hex, "%016llx", (unsigned long long)h);
+    return hex;
+}
+
+/**
+ * load_table(const string&,map<string,string>&) - "value<TAB>name" lines.
+ */
+void load_table(const string &path, map<string,string> &table)
+{
+    string text;
+    if(!read_file(path, text)) return;
+
+    size_t at = 0;
+    while(at < text.size())
+    {
+        size_t end = text.find('\n', at);
+        if(end == string::npos) end = text.size();
+        string line = text.substr(at, end-at);
+        if(!line.empty() && line[line.size()-1] == '\r') line.erase(line.size()-1);
+
+        size_t tab = line.find('\t');
+        if(tab != string::npos) table[line.substr(tab+1)] = line.substr(0, tab);
+        at = end+1;
+    }
+}
+
+bool save_table(const string &path, const map<string,string> &table)
+{
+    FILE *fp = fopen(path.c_str(), "w");
+    if(fp == NULL) return false;
+    for (map<string,string>::const_iterator it = table.begin(); it != table.end(); ++it)
+        fprintf(fp, "%s\t%s\n", it->second.c_str(), it->first.c_str());
+    return fclose(fp) == 0;
+}
+
+/**
+ * frame_time(const string&,double&) - the last "Frame time: <ms> ms" of a
+ *                      program's output, in seconds; false if none.
+ */
+bool frame_time(const string &log, double &sec)
+{
+    const char *tag = "Frame time: ";
+    size_t at = log.rfind(tag);
+    if(at == string::npos) return false;
+    sec = atof(log.c_str() + at + strlen(tag)) / 1e3;
+    return true;
+}
+
+/**
+ * run_case(const string&,const string&,int,double&) - runs the command
+ *                      with the case on its standard input, best of runs
+ *                      after one warm-up run. A run takes the frame time
+ *                      the program reports, or else the time of the whole
+ *                      command. Returns the exit status of the last run.
+ */
+int run_case(const string &command, const string &input, int runs, double &best)
+{
+    FILE *fp = fopen(INPUT_FILE, "w");
+    if(fp == NULL) return -1;
+    fputs(input.c_str(), fp);
+    fclose(fp);
+
+    string line = command + " < \"" + INPUT_FILE + "\" > \"" + LOG_FILE + "\"";
+#ifdef _WIN32
+    /// cmd.exe drops the outer quotes of a command that starts with one
+    line = "\"" + line + "\"";
+#endif
+
+    /// run -1 loads the program and its libraries into the cache; not timed
+    int status = 0;
+    best = 1e100;
+    for (int r = -1; r<runs; r++)
+    {
+        remove(OUTPUT_FILE);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        status = system(line.c_str());
+        double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if(status != 0) return status;
+
+        string log;
+        if(read_file(LOG_FILE, log)) frame_time(log, sec);
+        if(r >= 0) best = min(best, sec);
+    }
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    bool update = false;
+    double threshold = 25, slack = 1;
+    int runs = 5;
+    string root = "..", target = "Release";
+
+    for (int i = 1; i<argc; i++)
+    {
+        if(strcmp(argv[i], "-update") == 0) update = true;
+        else if(strcmp(argv[i], "-threshold") == 0 && i+1<argc) threshold = atof(argv[++i]);
+        else if(strcmp(argv[i], "-slack") == 0 && i+1<argc) slack = atof(argv[++i]);
+        else if(strcmp(argv[i], "-runs") == 0 && i+1<argc) runs = max(1, atoi(argv[++i]));
+        else if(strcmp(argv[i], "-root") == 0 && i+1<argc) root = argv[++i];
+        else if(strcmp(argv[i], "-target") == 0 && i+1<argc) target = argv[++i];
+    }
+
+    string golden_path = root + "/Regression/golden.txt";
+    string timing_path = root + "/Regression/timing.txt";
+    map<string,string> golden, timing, rendered;
+    load_table(golden_path, golden);
+    load_table(timing_path, timing);
+
+    int failed = 0, passed = 0, skipped = 0;
+    bool timing_changed = false;
+
+    for (int p = 0; p<PROGRAMS; p++)
+    {
+        const program &prog = programs[p];
+        string dir = root + "/" + prog.directory;
+
+        string source;
+        if(!read_file(dir + "/main.cpp", source))
+        {
+            printf("ERROR %s: cannot read %s/main.cpp\n", prog.name, dir.c_str());
+            failed++;
+            continue;
+        }
+
+        string command = "\"" + dir + "/bin/" + target + "/" + prog.executable + "\" -headless \"" + OUTPUT_FILE + "\" " + prog.options;
+        vector<string> cases = test_cases(source);
+
+        for (size_t k = 0; k<cases.size(); k++)
+        {
+            char name[128];
+            sprintf(name, "%s #%d", prog.name, (int)k+1);
+
+            double sec;
+            int status = run_case(command, cases[k], runs, sec);
+            string image;
+            if(status != 0 || !read_file(OUTPUT_FILE, image))
+            {
+                /// e.g. a program built without its offscreen backend
+                if(golden.count(name))
+                {
+                    printf("FAIL  %-26s did not render (exit status %d)\n", name, status);
+                    failed++;
+                }
+                else
+                {
+                    printf("SKIP  %-26s did not render (exit status %d)\n", name, status);
+                    skipped++;
+                }
+                continue;
+            }
+
+            string hash = image_hash(image);
+            rendered[name] = hash;
+            char ms[32];
+            sprintf(ms, "%.3f", sec*1e3);
+
+            if(*prog.same_as)
+            {
+                char other[128];
+                sprintf(other, "%s #%d", prog.same_as, (int)k+1);
+                if(rendered.count(other) && rendered[other] != hash)
+                {
+                    printf("FAIL  %-26s image %s, \"%s\" drew %s\n", name, hash.c_str(), other, rendered[other].c_str());
+                    failed++;
+                    continue;
+                }
+            }
+
+            if(update)
+            {
+                golden[name] = hash;
+                timing[name] = ms;
+                timing_changed = true;
+                printf("SET   %-26s %s %9.3f ms\n", name, hash.c_str(), sec*1e3);
+                continue;
+            }
+
+            bool ok = true;
+            if(!golden.count(name))
+                printf("NEW   %-26s %s, no golden hash yet (run with -update)\n", name, hash.c_str());
+            else if(golden[name] != hash)
+            {
+                string kept = string(name) + ".ppm";
+                FILE *fp = fopen(kept.c_str(), "wb");
+                if(fp != NULL) fwrite(image.data(), 1, image.size(), fp), fclose(fp);
+                printf("FAIL  %-26s image %s, golden %s; kept as \"%s\"\n", name, hash.c_str(), golden[name].c_str(), kept.c_str());
+                ok = false;
+            }
+
+            if(!timing.count(name))
+            {
+                timing[name] = ms;
+                timing_changed = true;
+            }
+            else
+            {
+                double base = atof(timing[name].c_str()), again;
+                double limit = max(base*(1 + threshold/100), base + slack);
+
+                /// a busy moment of the machine looks like a slow program; look twice
+                if(sec*1e3 > limit && run_case(command, cases[k], runs, again) == 0)
+                    sec = min(sec, again);
+                if(sec*1e3 > limit)
+                {
+                    printf("SLOW  %-26s %9.3f ms, baseline %9.3f ms (+%.1f%%)\n", name, sec*1e3, base, (sec*1e3/base - 1)*100);
+                    ok = false;
+                }
+            }
+
+            if(ok)
+            {
+                printf("PASS  %-26s %9.3f ms\n", name, sec*1e3);
+                passed++;
+            }
+            else failed++;
+        }
+    }
+
+    remove(INPUT_FILE);
+    remove(OUTPUT_FILE);
+    remove(LOG_FILE);
+
+    if(update && !save_table(golden_path, golden)) printf("Could not write %s\n", golden_path.c_str());
+    if(timing_changed && !save_table(timing_path, timing)) printf("Could not write %s\n", timing_path.c_str());
+
+    printf("%d passed, %d failed, %d skipped\n", passed, failed, skipped);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
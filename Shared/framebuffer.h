@@ -0,0 +1,240 @@
+#ifndef FRAMEBUFFER_H_INCLUDED
+#define FRAMEBUFFER_H_INCLUDED
+
+/**
+ * Software framebuffer
+ *
+ * A contiguous RGBA8 surface in main memory. Pixels are written straight
+ * into it without touching OpenGL, and the whole surface is flushed to the
+ * window (glDrawPixels) or dumped to a file once per frame. It does not
+ * need a display, so it also works on machines without GPU or X server.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+/**
+ * framebuffer - the pixel (x,y) of the gluOrtho2D co-ordinate system is
+ *               stored at pixels[(y-bottom)*width + (x-left)]. Row 0 is the
+ *               bottom row, which is also the order glDrawPixels expects.
+ *               Every pixel is packed as bytes R,G,B,A in memory order.
+ */
+struct framebuffer
+{
+    int left, bottom;
+    int width, height;
+    unsigned int color;
+    vector<unsigned int> pixels;
+};
+
+/**
+ * fb_rgba(float,float,float) - packs a glColor3f style color into one
+ *                              RGBA8 pixel value.
+ */
+inline unsigned int fb_rgba(float r, float g, float b)
+{
+    unsigned int R = r*255+0.5, G = g*255+0.5, B = b*255+0.5;
+    unsigned char bytes[4] = {(unsigned char)R, (unsigned char)G, (unsigned char)B, 255};
+    unsigned int pixel;
+    memcpy(&pixel, bytes, 4);
+    return pixel;
+}
+
+/**
+ * fb_init(framebuffer&,int,int,int,int) - allocates a W * H surface whose
+ *                                         bottom-left pixel is (left,bottom).
+ */
+inline void fb_init(framebuffer &fb, int left, int bottom, int width, int height)
+{
+    fb.left = left;
+    fb.bottom = bottom;
+    fb.width = width;
+    fb.height = height;
+    fb.color = fb_rgba(1,1,1);
+    fb.pixels.assign((size_t)width*height, fb_rgba(0,0,0));
+}
+
+/**
+ * fb_clear(framebuffer&) - the glClear(GL_COLOR_BUFFER_BIT) of the surface.
+ */
+inline void fb_clear(framebuffer &fb)
+{
+    fill(fb.pixels.begin(), fb.pixels.end(), fb_rgba(0,0,0));
+}
+
+/**
+ * fb_blit(framebuffer&,const framebuffer&) - copies a whole surface of the
+ *                      same size over dst; the cheap way to put a cached
+ *                      layer back each frame.
+ */
+inline void fb_blit(framebuffer &dst, const framebuffer &src)
+{
+    copy(src.pixels.begin(), src.pixels.end(), dst.pixels.begin());
+}
+
+/**
+ * fb_color(framebuffer&,float,float,float) - the glColor3f of the surface.
+ */
+inline void fb_color(framebuffer &fb, float r, float g, float b)
+{
+    fb.color = fb_rgba(r,g,b);
+}
+
+/**
+ * fb_random_shade(bool) - a random color channel of 100..255, as glColor3f
+ *                      takes it. With fixed set the numbers come from an
+ *                      LCG of its own instead of rand(), whose sequence
+ *                      differs from one C library to the next, so a
+ *                      headless image is the same on every machine.
+ */
+inline float fb_random_shade(bool fixed)
+{
+    static unsigned int seed = 1;
+    int r;
+    if(fixed)
+    {
+        seed = seed*1103515245u + 12345u;
+        r = (seed >> 16) & 0x7fff;
+    }
+    else r = rand();
+    return (100.0 + r%156)/255.0;
+}
+
+/**
+ * fb_set_pixel(framebuffer&,int,int) - writes the current color at (x,y).
+ *                                      Pixels outside the surface are
+ *                                      dropped, like OpenGL would do.
+ */
+inline void fb_set_pixel(framebuffer &fb, int x, int y)
+{
+    unsigned int col = x - fb.left, row = y - fb.bottom;
+    if(col >= (unsigned int)fb.width || row >= (unsigned int)fb.height) return;
+    fb.pixels[(size_t)row*fb.width + col] = fb.color;
+}
+
+/**
+ * fb_fill_row(unsigned int*,int,unsigned int) - stores n copies of the
+ *                      pixel value from p on. With SSE2 four pixels are
+ *                      written by every store.
+ */
+inline void fb_fill_row(unsigned int *p, int n, unsigned int color)
+{
+#ifdef __SSE2__
+    __m128i quad = _mm_set1_epi32(color);
+    for (; n>=4; n-=4, p+=4)
+        _mm_storeu_si128((__m128i*)p, quad);
+#endif
+    for (; n>0; n--)
+        *p++ = color;
+}
+
+/**
+ * fb_span(framebuffer&,int,int,int) - writes the current color on the
+ *                      horizontal run xl..xr (inclusive) of row y. The
+ *                      run is clipped to the surface first.
+ */
+inline void fb_span(framebuffer &fb, int y, int xl, int xr)
+{
+    unsigned int row = y - fb.bottom;
+    if(row >= (unsigned int)fb.height) return;
+
+    xl = max(xl, fb.left);
+    xr = min(xr, fb.left + fb.width - 1);
+    if(xl > xr) return;
+
+    fb_fill_row(&fb.pixels[(size_t)row*fb.width + (xl-fb.left)], xr-xl+1, fb.color);
+}
+
+/**
+ * fb_line(framebuffer&,double,double,double,double) - the GL_LINES of the
+ *                      surface. The segment is clipped to the surface
+ *                      (Liang-Barsky), rounded to pixels and drawn with
+ *                      Bresenham in the current color.
+ */
+inline void fb_line(framebuffer &fb, double x1, double y1, double x2, double y2)
+{
+    double X0 = fb.left-1, Y0 = fb.bottom-1, X1 = fb.left+fb.width, Y1 = fb.bottom+fb.height;
+    double dx = x2-x1, dy = y2-y1, u1 = 0, u2 = 1;
+    double p[4] = {-dx, dx, -dy, dy};
+    double q[4] = {x1-X0, X1-x1, y1-Y0, Y1-y1};
+
+    for (int i = 0; i<4; i++)
+    {
+        if(p[i] == 0)
+        {
+            if(q[i] < 0) return;
+            continue;
+        }
+
+        double r = q[i]/p[i];
+        if(p[i] < 0) u1 = max(u1, r);
+        else u2 = min(u2, r);
+    }
+    if(u1 > u2) return;
+
+    int ax = floor(x1 + u1*dx + 0.5), ay = floor(y1 + u1*dy + 0.5);
+    int bx = floor(x1 + u2*dx + 0.5), by = floor(y1 + u2*dy + 0.5);
+
+    int ex = abs(bx-ax), sx = ax<bx ? 1 : -1;
+    int ey = -abs(by-ay), sy = ay<by ? 1 : -1;
+    int err = ex + ey;
+
+    while(true)
+    {
+        fb_set_pixel(fb, ax, ay);
+        if(ax == bx && ay == by) break;
+
+        int e2 = 2*err;
+        if(e2 >= ey) err += ey, ax += sx;
+        if(e2 <= ex) err += ex, ay += sy;
+    }
+}
+
+/**
+ * fb_clock_ms() - a steady clock in milliseconds. Headless runs print the
+ *                 time their frame took as "Frame time: <ms> ms", and the
+ *                 regression harness reads it from there, as timing the
+ *                 whole process would mostly time its start.
+ */
+inline double fb_clock_ms()
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * fb_write_ppm(const framebuffer&,const char*) - dumps the surface as a
+ *                       binary PPM (P6) image, top row first. Returns false
+ *                       if the file could not be written.
+ */
+inline bool fb_write_ppm(const framebuffer &fb, const char *path)
+{
+    FILE *fp = fopen(path, "wb");
+    if(fp == NULL) return false;
+
+    fprintf(fp, "P6\n%d %d\n255\n", fb.width, fb.height);
+
+    vector<unsigned char> line(fb.width*3);
+    for (int row = fb.height-1; row>=0; row--)
+    {
+        const unsigned char *src = (const unsigned char*)&fb.pixels[(size_t)row*fb.width];
+        for (int i = 0; i<fb.width; i++)
+        {
+            line[3*i] = src[4*i];
+            line[3*i+1] = src[4*i+1];
+            line[3*i+2] = src[4*i+2];
+        }
+        fwrite(&line[0], 1, line.size(), fp);
+    }
+
+    return fclose(fp) == 0;
+}
+
+#endif // FRAMEBUFFER_H_INCLUDED
@@ -0,0 +1,155 @@
+#ifndef WORK_STEALING_POOL_H_INCLUDED
+#define WORK_STEALING_POOL_H_INCLUDED
+
+/**
+ * Work-stealing thread pool
+ *
+ * Shared by the tiled line drawing (Line Drawing/tiled.h) and the band
+ * fill (Region Filling/bands.h); both projects include it from here.
+ */
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+using namespace std;
+
+/**
+ * work_stealing_pool - a fixed set of worker threads. run() deals the
+ *                      tasks round-robin into one deque per thread; a
+ *                      thread pops from the back of its own deque and,
+ *                      once that is empty, steals from the front of the
+ *                      others. The calling thread works as thread 0.
+ */
+struct work_stealing_pool
+{
+    struct task_queue
+    {
+        mutex lock;
+        deque<int> tasks;
+    };
+
+    vector<thread> workers;
+    vector<task_queue*> queues;
+    function<void(int)> job;
+
+    mutex lock;
+    condition_variable wake, done;
+    int remaining;
+    unsigned int generation;
+    bool stopping;
+
+    work_stealing_pool(int threads = thread::hardware_concurrency())
+    {
+        threads = max(threads, 1);
+        remaining = 0;
+        generation = 0;
+        stopping = false;
+
+        for (int i = 0; i<threads; i++)
+            queues.push_back(new task_queue);
+        for (int i = 1; i<threads; i++)
+            workers.push_back(thread(&work_stealing_pool::worker, this, i));
+    }
+
+    ~work_stealing_pool()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for (size_t i = 0; i<workers.size(); i++)
+            workers[i].join();
+        for (size_t i = 0; i<queues.size(); i++)
+            delete queues[i];
+    }
+
+    int size() const
+    {
+        return queues.size();
+    }
+
+    /**
+     * take(int,int&) - next task of thread self: own deque first, then
+     *                  steal from the others.
+     */
+    bool take(int self, int &task)
+    {
+        for (size_t k = 0; k<queues.size(); k++)
+        {
+            task_queue &q = *queues[(self+k) % queues.size()];
+            lock_guard<mutex> guard(q.lock);
+            if(q.tasks.empty()) continue;
+
+            if(k == 0) task = q.tasks.back(), q.tasks.pop_back();
+            else task = q.tasks.front(), q.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void drain(int self)
+    {
+        int task, finished = 0;
+        while(take(self, task))
+        {
+            job(task);
+            finished++;
+        }
+
+        if(finished == 0) return;
+
+        lock_guard<mutex> guard(lock);
+        remaining -= finished;
+        if(remaining == 0) done.notify_all();
+    }
+
+    void worker(int self)
+    {
+        unsigned int seen = 0;
+        while(true)
+        {
+            {
+                unique_lock<mutex> guard(lock);
+                while(!stopping && seen == generation) wake.wait(guard);
+                if(stopping) return;
+                seen = generation;
+            }
+            drain(self);
+        }
+    }
+
+    /**
+     * run(int,function<void(int)>) - calls f(0) .. f(count-1) on the pool
+     *                                and returns when all of them are done.
+     */
+    void run(int count, function<void(int)> f)
+    {
+        if(count == 0) return;
+
+        job = f;
+        {
+            lock_guard<mutex> guard(lock);
+            remaining = count;
+            generation++;
+        }
+
+        for (int i = 0; i<count; i++)
+        {
+            task_queue &q = *queues[i % queues.size()];
+            lock_guard<mutex> guard(q.lock);
+            q.tasks.push_back(i);
+        }
+        wake.notify_all();
+
+        drain(0);
+
+        unique_lock<mutex> guard(lock);
+        while(remaining > 0) done.wait(guard);
+    }
+};
+
+#endif // WORK_STEALING_POOL_H_INCLUDED
@@ -10,6 +10,21 @@
  *  3. Scaling
  */
 #include "headers.h"
+#include "../Shared/framebuffer.h"
+
+/**
+ * Headless mode (-headless out.ppm): no window is opened. Everything is
+ * drawn into the software framebuffer "screen" and the one frame is
+ * written to out.ppm, so the program also runs without a display.
+ */
+const char *headless_output = NULL;
+framebuffer screen;
+
+/**
+ * Key presses replayed in headless mode (-keys "ww+1"), as if typed in the
+ * window, before the frame is written.
+ */
+const char *headless_keys = "";
 
 double rotation_factor;
 double translation_factor;
@@ -19,11 +34,44 @@ int n;
 
 vector< pair< pair<double, double>, pair<double,double> > >lines;
 
+/**
+ * SetColor(float,float,float) - glColor3f, or the drawing color of the
+ *                               framebuffer in headless mode.
+ */
+void SetColor(float r, float g, float b)
+{
+    if(headless_output != NULL) fb_color(screen, r, g, b);
+    else glColor3f(r, g, b);
+}
+
+/**
+ * ClearScreen() - glClear, or clearing the framebuffer in headless mode.
+ */
+void ClearScreen()
+{
+    if(headless_output != NULL) fb_clear(screen);
+    else glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+/**
+ * ShowFrame() - glutSwapBuffers; nothing to show in headless mode.
+ */
+void ShowFrame()
+{
+    if(headless_output == NULL) glutSwapBuffers();
+}
+
 /**
  * This function draws a line from (x1, y1) to (x2,y2) pixel co-ordinate.
  */
 void DrawLine(double x1, double  y1, double x2, double y2)
 {
+    if(headless_output != NULL)
+    {
+        fb_line(screen, x1, y1, x2, y2);
+        return;
+    }
+
     /**
      * glBegin(GLbitfield mask) - delimit the vertices of a primitive or
      *                            a group of like primitives
@@ -49,12 +97,61 @@ void DrawLine(double x1, double  y1, double x2, double y2)
     return;
 }
 
-void RedrawLines()
+/**
+ * StaticLayer() - the part of the picture that never changes between
+ *                 frames.
+ */
+void StaticLayer()
 {
-    glColor3f(1,0,0); // cyan color
+    SetColor(1,0,0); // cyan color
     DrawLine(-350,0,350,0);
     DrawLine(0,-350,0,350);
-    glColor3f((100.0+rand()%156)/255.0, (100.0+rand()%156)/255.0, (100.0+rand()%156)/255.0);
+}
+
+GLuint static_list = 0;
+
+/**
+ * DrawStaticLayer() - draws the axes. They never change between frames,
+ *                     so the first call records them into a display list
+ *                     and later calls only replay it. The framebuffer
+ *                     just draws the two lines again: a copy of the whole
+ *                     surface costs more.
+ */
+void DrawStaticLayer()
+{
+    if(headless_output != NULL)
+    {
+        StaticLayer();
+        return;
+    }
+
+    if(static_list != 0)
+    {
+        /**
+         * glCallList(GLuint list) - executes the commands recorded in
+         *                           the display list.
+         */
+        glCallList(static_list);
+        return;
+    }
+
+    /**
+     * glNewList(GLuint list, GLenum mode) - starts recording GL commands
+     *                          into a display list. GL_COMPILE_AND_EXECUTE
+     *                          also runs them while recording.
+     */
+    static_list = glGenLists(1);
+    glNewList(static_list, GL_COMPILE_AND_EXECUTE);
+    StaticLayer();
+    glEndList();
+}
+
+void RedrawLines()
+{
+    DrawStaticLayer();
+    bool fixed = headless_output != NULL;
+    float r = fb_random_shade(fixed), g = fb_random_shade(fixed), b = fb_random_shade(fixed);
+    SetColor(r, g, b);
 
     for (int i = 0; i<lines.size(); i++)
         DrawLine(lines[i].first.first, lines[i].first.second, lines[i].second.first, lines[i].second.second);
@@ -74,7 +171,7 @@ void Translate(double tx, double ty)
 
 void Rotate(double angle)
 {
-    glClear(GL_COLOR_BUFFER_BIT);
+    ClearScreen();
 
     double x, y;
     double ac, as;
@@ -99,7 +196,7 @@ void Rotate(double angle)
 
 void Scale(double sx,double sy)
 {
-    glClear(GL_COLOR_BUFFER_BIT);
+    ClearScreen();
     double h, l;
     h=0; /// the x co-ordinate of the reference point
     l=0; /// the y co-ordinate of the reference point
@@ -118,7 +215,7 @@ void Scale(double sx,double sy)
 
 static void key(unsigned char key, int x, int y)
 {
-    glClear(GL_COLOR_BUFFER_BIT);
+    ClearScreen();
     switch (key)
     {
         case 27 :
@@ -127,58 +224,58 @@ static void key(unsigned char key, int x, int y)
             exit(0);
             break;
         case 'c':
-            glutSwapBuffers();
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);	// Clean the screen and the depth buffer
+            ShowFrame();
+            ClearScreen();	// Clean the screen and the depth buffer
             RedrawLines();
-            glutSwapBuffers();
+            ShowFrame();
             break;
         case 'w':
 
             Translate(0,translation_factor);
 
-            glutSwapBuffers();
+            ShowFrame();
             RedrawLines();
-            glutSwapBuffers();
+            ShowFrame();
             break;
 
         case 's':
             Translate(0,-translation_factor);
 
-            glutSwapBuffers();
+            ShowFrame();
             RedrawLines();
-            glutSwapBuffers();
+            ShowFrame();
             break;
         case 'a':
 
             Translate(-translation_factor,0);
 
-            glutSwapBuffers();
+            ShowFrame();
             RedrawLines();
-            glutSwapBuffers();
+            ShowFrame();
             break;
 
         case 'd':
             Translate(translation_factor,0);
 
-            glutSwapBuffers();
+            ShowFrame();
             RedrawLines();
-            glutSwapBuffers();
+            ShowFrame();
             break;
         case '+':
 
             Scale(scaling_factor_x,scaling_factor_y);
 
-            glutSwapBuffers();
+            ShowFrame();
             RedrawLines();
-            glutSwapBuffers();
+            ShowFrame();
             break;
 
         case '-':
             Scale(1/scaling_factor_x,1/scaling_factor_y);
 
-            glutSwapBuffers();
+            ShowFrame();
             RedrawLines();
-            glutSwapBuffers();
+            ShowFrame();
             break;
 
         case 'l':
@@ -186,18 +283,18 @@ static void key(unsigned char key, int x, int y)
 
             Rotate(rotation_factor);
 
-            glutSwapBuffers();
+            ShowFrame();
             RedrawLines();
-            glutSwapBuffers();
+            ShowFrame();
             break;
 
         case 'r':
         case '2':
             Rotate(-rotation_factor);
 
-            glutSwapBuffers();
+            ShowFrame();
             RedrawLines();
-            glutSwapBuffers();
+            ShowFrame();
             break;
     }
 
@@ -207,10 +304,10 @@ static void key(unsigned char key, int x, int y)
 
 void transformation(void)
 {
-    glClear(GL_COLOR_BUFFER_BIT);
-    glutSwapBuffers();
+    ClearScreen();
+    ShowFrame();
     RedrawLines();
-    glutSwapBuffers();
+    ShowFrame();
     return;
 }
 
@@ -218,49 +315,57 @@ int main(int argc, char *argv[])
 {
     int x1, y1, x2, y2;
 
-    /**
-     * glutInit(int, char*) - initializes glut environment.
-     */
-    glutInit(&argc, argv);
-    /**
-     * glutInitWindowSize(int,int)- initializes new glut window of
-     *                              size W * H
-     *                              default: 300, 300
-     */
-    glutInitWindowSize(700,700);
-    /**
-     * glutInitWindowPosition(int,int) - set the origin of the
-     *                                   co-ordinate
-     *                                   default: -1, -1
-     */
-    glutInitWindowPosition(10,10);
-
-    /**
-     * glutInitDisplayMode(unsigned int) - set the initial display mode.
-     *                      It can take a combinations of some masks
-     *                      which are not overlapped in their binary
-     *                      representation. So, it takes them having
-     *                      bitwise OR.
-     * GLUT_RGB - the color input would by set by RGB values.
-     * GLUT_DOUBLE - makes it double buffered. It is like using two blackboard.
-     *               One blackboard would be shown to the screen and hidden one
-     *               would be processed behind. they can be swapped any time.
-     * GLUT_DEPTH - It is mainly enables depth concept. Algorithm like z-buffering
-     *              could be done by using this.
-     */
-    glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
-
-    /**
-     * glutCreateWindow(char*) - creates a top-level window having the title
-     *                           given as parameter.
-     */
-    glutCreateWindow("2-Dimensional Transformation");
+    for (int i = 1; i<argc; i++)
+        if(strcmp(argv[i], "-headless") == 0 && i+1<argc) headless_output = argv[++i];
+        else if(strcmp(argv[i], "-keys") == 0 && i+1<argc) headless_keys = argv[++i];
 
-    /**
-     * gluOrtho2D(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top) -
-     *                              define a 2D orthographic projection matrix
-     */
-    gluOrtho2D(-350,350,-350,350);
+    if(headless_output == NULL)
+    {
+        /**
+         * glutInit(int, char*) - initializes glut environment.
+         */
+        glutInit(&argc, argv);
+        /**
+         * glutInitWindowSize(int,int)- initializes new glut window of
+         *                              size W * H
+         *                              default: 300, 300
+         */
+        glutInitWindowSize(700,700);
+        /**
+         * glutInitWindowPosition(int,int) - set the origin of the
+         *                                   co-ordinate
+         *                                   default: -1, -1
+         */
+        glutInitWindowPosition(10,10);
+
+        /**
+         * glutInitDisplayMode(unsigned int) - set the initial display mode.
+         *                      It can take a combinations of some masks
+         *                      which are not overlapped in their binary
+         *                      representation. So, it takes them having
+         *                      bitwise OR.
+         * GLUT_RGB - the color input would by set by RGB values.
+         * GLUT_DOUBLE - makes it double buffered. It is like using two blackboard.
+         *               One blackboard would be shown to the screen and hidden one
+         *               would be processed behind. they can be swapped any time.
+         * GLUT_DEPTH - It is mainly enables depth concept. Algorithm like z-buffering
+         *              could be done by using this.
+         */
+        glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
+
+        /**
+         * glutCreateWindow(char*) - creates a top-level window having the title
+         *                           given as parameter.
+         */
+        glutCreateWindow("2-Dimensional Transformation");
+
+        /**
+         * gluOrtho2D(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top) -
+         *                              define a 2D orthographic projection matrix
+         */
+        gluOrtho2D(-350,350,-350,350);
+    }
+    else fb_init(screen, -350, -350, 700, 700);
     printf("At first you have to give some constant factors, which mean it would work for how many units in one iteration.\n");
 
     printf("Translation factor: ");
@@ -284,6 +389,21 @@ int main(int argc, char *argv[])
         lines.pb(mp(mp(x1,y1),mp(x2,y2)));
     }
 
+    if(headless_output != NULL)
+    {
+        double start = fb_clock_ms();
+        transformation();
+        for (const char *k = headless_keys; *k; k++)
+            key(*k, 0, 0);
+        printf("Frame time: %.3f ms\n", fb_clock_ms() - start);
+        if(!fb_write_ppm(screen, headless_output))
+        {
+            printf("Could not write %s\n", headless_output);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
     /**
      * void glutDisplayFunc(void (*func)(void))  - this function takes a function pointer
      *                                             in which all works done.